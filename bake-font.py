@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Bakes vgafont.ttf into include/cosmovm/vga_font.hpp, rerun it when the font changes
+# Needs Pillow: python3 -m pip install pillow
+import sys
+from pathlib import Path
+
+from PIL import Image, ImageDraw, ImageFont
+
+ROOT_DIR = Path(__file__).resolve().parent
+FONT_PATH = ROOT_DIR / "vgafont.ttf"
+HEADER_PATH = ROOT_DIR / "include" / "cosmovm" / "vga_font.hpp"
+GLYPH_W = 8
+GLYPH_H = 8
+GLYPH_COUNT = 256
+
+
+def license_header():
+    # Same notice as the sources, taken from common.hpp
+    common = (ROOT_DIR / "include" / "cosmovm" / "common.hpp").read_text()
+    return common[:common.index("*/") + 2]
+
+
+def bake_glyph(font, glyph):
+    # Rendered like TTF_RenderGlyph_Solid: not antialiased, top at the ascender
+    image = Image.new("L", (GLYPH_W, GLYPH_H), 0)
+    draw = ImageDraw.Draw(image)
+    draw.fontmode = "1"
+    draw.text((0, 0), chr(glyph), font=font, fill=255)
+    rows = []
+    for y in range(GLYPH_H):
+        row = 0
+        for x in range(GLYPH_W):
+            if image.getpixel((x, y)) > 127:
+                row |= 0x80 >> x
+        rows.append(row)
+    return rows
+
+
+def main():
+    font = ImageFont.truetype(str(FONT_PATH), GLYPH_H)
+    lines = [
+        license_header(),
+        "",
+        "// Generated by bake-font.py from vgafont.ttf, do not edit",
+        "",
+        "#ifndef VGA_FONT_HPP",
+        "#define VGA_FONT_HPP",
+        "",
+        "#include <array>",
+        "",
+        "#include \"common.hpp\"",
+        "",
+        "namespace cosmovm",
+        "{",
+        f"    constexpr u16 VGA_FONT_W = {GLYPH_W};",
+        f"    constexpr u16 VGA_FONT_H = {GLYPH_H};",
+        "",
+        "    // One byte per row, most significant bit on the left",
+        f"    constexpr std::array<std::array<u8, VGA_FONT_H>, {GLYPH_COUNT}> VGA_FONT =",
+        "    {{",
+    ]
+    # Glyph 0 stays blank, it ends the text
+    for glyph in range(GLYPH_COUNT):
+        rows = bake_glyph(font, glyph) if glyph != 0 else [0] * GLYPH_H
+        values = ", ".join(f"0x{row:02X}" for row in rows)
+        lines.append(f"        {{{{{values}}}}}, // 0x{glyph:02X}")
+    lines += [
+        "    }};",
+        "}",
+        "",
+        "#endif /* VGA_FONT_HPP */",
+    ]
+    # No newline at the end, like the other headers
+    HEADER_PATH.write_text("\n".join(lines))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -4,30 +4,23 @@
 ; AZ: LBA Index
 ; BZ: Dest ptr
 locate sector_load
-    push az
-    push bz
     push cz
-    push hz
 
     movi cz, 0
     out cz, 0x61                        ; Set read mode
+    out az, 0x62                        ; Read from specified LBA
 
-    mov cz, az
-    out cz, 0x62                        ; Read from specified LBA
+    mov cz, bz
+    add cz, mo                          ; DMA takes absolute addresses
+    out cz, 0x68                        ; Set destination
+    movi cz, 1
+    out cz, 0x69                        ; One sector
+    out cz, 0x6A                        ; Start transfer
 
-    movi cz, 0
-    out cz, 0x63                        ; Request read
-
-    ; Copy disk read buffer to memory
-    movi hz, 0x200                      ; Copy 512 bytes
-    locate sector_load_loop
-        in cz, 0x64                     ; Get character
-        storb bz, cz                    ; Copy to buffer
-        inc bz,                         ; Increment pointer
-    lop sector_load_loop
+    locate sector_load_wait
+        in cz, 0x67                     ; Busy until the transfer is done
+        cmpi cz, 1
+    je sector_load_wait
 
-    pop hz
     pop cz
-    pop bz
-    pop az
     ret
\ No newline at end of file
@@ -0,0 +1,76 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANSI_BACKEND_HPP
+#define ANSI_BACKEND_HPP
+
+#include <string>
+
+#include <signal.h>
+
+#include "common.hpp"
+#include "display_backend.hpp"
+
+namespace cosmovm
+{
+    // Draws text mode on a terminal with ANSI escapes. Only the cells that
+    // changed since the last frame are sent, each frame is one write.
+    // The graphic modes are not drawn, the screen says so instead
+    class ansi_backend : public display_backend
+    {
+        private:
+            int m_fd;
+            // Screen as the terminal shows it
+            text_screen m_text_shadow;
+            VIDEO_MODES m_drawn_mode;
+            bool m_redraw;
+            // Escapes and characters of the frame being drawn
+            std::string m_out;
+            // Where the terminal cursor is, -1 when unknown
+            int m_cursor;
+            u32 m_foreground;
+            u32 m_background;
+            usz m_frames;
+            // Put back when the terminal is given back
+            struct sigaction m_old_sigint;
+            struct sigaction m_old_sigterm;
+
+        public:
+            // Takes over the terminal behind fd (ex: STDOUT_FILENO), SIGINT and
+            // SIGTERM then close the display instead of killing the emulator
+            ansi_backend(int fd);
+            ansi_backend(const ansi_backend&) = delete;
+            ansi_backend() = delete;
+            // Gives the terminal back with its colors and cursor
+            ~ansi_backend();
+
+            bool poll_events() override;
+            void render_text(const text_screen& screen) override;
+            void render_graphic(const u8* pixels, const gfx_rows& dirty_rows) override;
+
+            usz get_frames_count() const;
+
+        private:
+            void move_to(u16 cell);
+            void set_colors(u32 foreground, u32 background);
+            void put_glyph(u8 glyph);
+            void flush();
+    };
+}
+
+#endif /* ANSI_BACKEND_HPP */
\ No newline at end of file
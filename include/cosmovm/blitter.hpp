@@ -0,0 +1,106 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLITTER_HPP
+#define BLITTER_HPP
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "bus.hpp"
+
+namespace cosmovm
+{
+    // Any key above 0xFF never matches a pixel
+    constexpr u16 BLIT_NO_KEY = 0x100;
+
+    typedef enum BLIT_COMMANDS
+    {
+        BLIT_FILL = 0,      // Destination rectangle set to the fill color
+        BLIT_COPY = 1,      // Source rectangle copied to the destination, overlap allowed
+        BLIT_MASKED = 2,    // Like copy, source pixels equal to the key are skipped
+    }BLIT_COMMANDS;
+
+    typedef enum BLIT_STATUS
+    {
+        BLIT_READY = 0,     // Last command completed
+        BLIT_FAULT = 1,     // Rectangle past the end of memory or unknown command
+    }BLIT_STATUS;
+
+    // Rectangle operations on 8-bit pixels anywhere in memory, ex: sprites
+    // into the graphic mode framebuffer. Commands complete before the OUT returns
+    class blitter
+    {
+        private:
+            std::shared_ptr<bus>& m_bus;
+            u16 m_src;
+            u16 m_dst;
+            u16 m_width;
+            u16 m_height;
+            // 0 means rows are packed, stride = width
+            u16 m_src_stride;
+            u16 m_dst_stride;
+            u8 m_fill;
+            u16 m_key;
+            BLIT_STATUS m_status;
+            // One row, or the whole source when it overlaps a destination of another stride
+            std::vector<u8> m_src_row;
+            std::vector<u8> m_dst_row;
+
+        public:
+            blitter() = delete;
+            blitter(const blitter&) = delete;
+            blitter(std::shared_ptr<bus>& bus);
+            ~blitter();
+
+            void set_src(u16 addr);
+            void set_dst(u16 addr);
+            void set_width(u16 width);
+            void set_height(u16 height);
+            void set_src_stride(u16 stride);
+            void set_dst_stride(u16 stride);
+            void set_fill(u16 color);
+            void set_key(u16 key);
+            void run_command(u16 command);
+            u16 get_status();
+
+            static constexpr std::array<port_descriptor<blitter>, 10> PORTS =
+            {{
+                {0x91, nullptr, &blitter::set_src},
+                {0x92, nullptr, &blitter::set_dst},
+                {0x93, nullptr, &blitter::set_width},
+                {0x94, nullptr, &blitter::set_height},
+                {0x95, nullptr, &blitter::set_src_stride},
+                {0x96, nullptr, &blitter::set_dst_stride},
+                {0x97, nullptr, &blitter::set_fill},
+                {0x98, nullptr, &blitter::set_key},
+                {0x99, nullptr, &blitter::run_command},
+                {0x9A, &blitter::get_status, nullptr},
+            }};
+
+        private:
+            u16 row_stride(u16 stride) const;
+            static bool fits(u16 addr, u16 stride, u16 width, u16 height);
+            void fill();
+            void copy(bool masked);
+    };
+}
+
+#endif /* BLITTER_HPP */
\ No newline at end of file
@@ -19,36 +19,125 @@
 #ifndef BUS_HPP
 #define BUS_HPP
 
-#include <functional>
 #include <memory>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "common.hpp"
 #include "memory.hpp"
 
 namespace cosmovm
 {
-    constexpr u16 PORT_DUMMY_VALUE = 0xFFFF;
+    constexpr u32 PORT_COUNT = 0x10000;
+
+    typedef u16 (*port_in_handler)(void* ctx, u16 port);
+    typedef void (*port_out_handler)(void* ctx, u16 port, u16 data);
+    typedef void (*port_fault_handler)(void* ctx, u16 port);
+
+    typedef struct port_in_entry
+    {
+        port_in_handler handler;
+        void* ctx;
+    }port_in_entry;
+
+    typedef struct port_out_entry
+    {
+        port_out_handler handler;
+        void* ctx;
+    }port_out_entry;
+
+    // Adapt device member functions to port handlers
+    template<typename Device, u16 (Device::*FUNC)()>
+    u16 port_in(void* ctx, u16)
+    {
+        return (static_cast<Device*>(ctx)->*FUNC)();
+    }
+
+    template<typename Device, void (Device::*FUNC)(u16)>
+    void port_out(void* ctx, u16, u16 data)
+    {
+        (static_cast<Device*>(ctx)->*FUNC)(data);
+    }
+
+    // Devices list their ports in a constexpr PORTS array of these
+    template<typename Device>
+    struct port_descriptor
+    {
+        u16 port;
+        u16 (Device::*in)();
+        void (Device::*out)(u16);
+    };
+
+    template<typename Device, u16 (Device::*FUNC)()>
+    constexpr port_in_handler port_in_or_null()
+    {
+        if constexpr (FUNC == nullptr)
+            return nullptr;
+        else
+            return &port_in<Device, FUNC>;
+    }
+
+    template<typename Device, void (Device::*FUNC)(u16)>
+    constexpr port_out_handler port_out_or_null()
+    {
+        if constexpr (FUNC == nullptr)
+            return nullptr;
+        else
+            return &port_out<Device, FUNC>;
+    }
 
     class bus
     {
         private:
             std::shared_ptr<memory>& m_memory;
-            std::unordered_map<u16, std::function<u16(u16)>> m_port;
+            // Indexed by port number, unbound ports point to the fault handlers
+            std::vector<port_in_entry> m_port_in;
+            std::vector<port_out_entry> m_port_out;
+            port_fault_handler m_fault_handler;
+            void* m_fault_ctx;
 
         public:
             bus() = delete;
             bus(std::shared_ptr<memory>& memory_ref);
 
-            void bind_port(u16 port, const std::function<u16(u16)>& func_ptr);
+            // Either handler may be null if the port is one-way
+            void bind_port(u16 port, port_in_handler in, port_out_handler out, void* ctx);
+            void set_fault_handler(port_fault_handler handler, void* ctx);
+            // Devices report guest values they can't accept on their ports here
+            void fault(u16 port);
             u16 device_in(u16 port);
             void device_out(u16 port, u16 data);
 
+            template<typename Device>
+            void bind_device(Device* device)
+            {
+                bind_descriptors(device, std::make_index_sequence<Device::PORTS.size()>{});
+            }
+
+            // Entry points for the CPU, ctx is the bus
+            static u16 dispatch_in(void* ctx, u16 port);
+            static void dispatch_out(void* ctx, u16 port, u16 data);
+
             u8 mem_read8(u16 addr);
             u16 mem_read16(u16 addr);
             void mem_write8(u16 addr, u8 data);
             void mem_write16(u16 addr, u16 data);
             const std::shared_ptr<memory>& get_memory() const;
+
+        private:
+            template<typename Device, usz... I>
+            void bind_descriptors(Device* device, std::index_sequence<I...>)
+            {
+                (bind_port(
+                    Device::PORTS[I].port,
+                    port_in_or_null<Device, Device::PORTS[I].in>(),
+                    port_out_or_null<Device, Device::PORTS[I].out>(),
+                    device), ...);
+            }
+
+            static u16 unbound_in(void* ctx, u16 port);
+            static void unbound_out(void* ctx, u16 port, u16 data);
+            static void ignore_fault(void* ctx, u16 port);
     };
 }
 
@@ -0,0 +1,96 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "display_backend.hpp"
+#include "headless_backend.hpp"
+
+namespace cosmovm
+{
+    constexpr usz CAPTURE_QUEUE_DEPTH = 8;
+
+    typedef enum CAPTURE_FORMATS
+    {
+        CAPTURE_Y4M = 0,    // YUV4MPEG2 4:2:0, frames tagged XUS=<microseconds>
+        CAPTURE_RGB = 1,    // Raw RGB24 frames, timestamps in PATH.pts
+    }CAPTURE_FORMATS;
+
+    typedef struct capture_frame
+    {
+        VIDEO_MODES mode;
+        text_registers text;
+        std::array<u8, VIDEO_MEM_SIZE> vram;
+        // Since the capture started
+        std::chrono::microseconds timestamp;
+    }capture_frame;
+
+    // Records what the guest drew into a file or a named pipe. Frames are
+    // queued by the emulation thread and drawn, encoded and written on a
+    // writer thread, a full queue drops the frame instead of waiting
+    class frame_capture
+    {
+        private:
+            CAPTURE_FORMATS m_format;
+            std::ofstream m_file;
+            std::ofstream m_pts_file;
+            headless_backend m_screen;
+            std::vector<u8> m_encoded;
+            text_screen m_text_screen;
+            std::array<u8, GFX_MODE_W * GFX_MODE_H> m_tile_pixels;
+
+            std::chrono::steady_clock::time_point m_start;
+            std::mutex m_mutex;
+            std::condition_variable m_queue_cv;
+            std::deque<std::unique_ptr<capture_frame>> m_queue;
+            // Frames handed back by the writer, reused by push
+            std::vector<std::unique_ptr<capture_frame>> m_free;
+            bool m_quit;
+            usz m_written;
+            usz m_dropped;
+            std::thread m_writer;
+
+        public:
+            frame_capture(const std::string& path, CAPTURE_FORMATS format);
+            frame_capture(const frame_capture&) = delete;
+            frame_capture() = delete;
+            // Writes the frames still queued
+            ~frame_capture();
+
+            void push(VIDEO_MODES mode, const text_registers& text, const u8* vram);
+
+        private:
+            void writer_loop();
+            void encode(const capture_frame& frame);
+    };
+}
+
+#endif /* CAPTURE_HPP */
\ No newline at end of file
@@ -19,6 +19,8 @@
 #ifndef CLOCK_HPP
 #define CLOCK_HPP
 
+#include <array>
+
 #include "common.hpp"
 #include "bus.hpp"
 
@@ -34,12 +36,22 @@ namespace cosmovm
             clock(std::shared_ptr<bus>& bus);
             ~clock();
 
-            u16 get_year(u16 dummy);
-            u16 get_month(u16 dummy);
-            u16 get_day(u16 dummy);
-            u16 get_hour(u16 dummy);
-            u16 get_min(u16 dummy);
-            u16 get_seconds(u16 dummy);
+            u16 get_year();
+            u16 get_month();
+            u16 get_day();
+            u16 get_hour();
+            u16 get_min();
+            u16 get_seconds();
+
+            static constexpr std::array<port_descriptor<clock>, 6> PORTS =
+            {{
+                {0x31, &clock::get_year, nullptr},
+                {0x32, &clock::get_month, nullptr},
+                {0x33, &clock::get_day, nullptr},
+                {0x34, &clock::get_hour, nullptr},
+                {0x35, &clock::get_min, nullptr},
+                {0x36, &clock::get_seconds, nullptr},
+            }};
     };
 }
 
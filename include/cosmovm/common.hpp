@@ -28,6 +28,7 @@ namespace cosmovm
     typedef std::uint8_t u8;
     typedef std::uint16_t u16;
     typedef std::uint32_t u32;
+    typedef std::uint64_t u64;
     typedef std::size_t usz;
 }
 
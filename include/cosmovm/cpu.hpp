@@ -22,6 +22,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "common.hpp"
 #include "bus.hpp"
@@ -155,6 +156,12 @@ namespace cosmovm
             u16 m_flags{0};
             std::shared_ptr<bus>& m_bus;
             std::unordered_map<INSTRUCTION, std::function<void(u32)>> executers;
+            // IN/OUT target, the bus unless a machine resolves ports itself
+            port_in_handler m_io_in;
+            port_out_handler m_io_out;
+            void* m_io_ctx;
+            // Only the first fault of each port is logged
+            std::vector<bool> m_faulted_ports;
 
         public:
             cpu() = delete;
@@ -162,6 +169,7 @@ namespace cosmovm
             ~cpu();
 
             void run();
+            void attach_io(port_in_handler io_in, port_out_handler io_out, void* ctx);
             bool shutdown_flag_set();
             bool exception_flag_set();
 
@@ -176,6 +184,8 @@ namespace cosmovm
             void mem_push(u16 data);
 
             void set_cmp_flags(u16 operand1, u16 operand2);
+
+            static void port_fault(void* ctx, u16 port);
     };
 }
 
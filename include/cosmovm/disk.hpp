@@ -21,14 +21,25 @@
 
 #include <cstring>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "common.hpp"
 #include "bus.hpp"
+#include "disk_image.hpp"
+#include "memory.hpp"
 
 namespace cosmovm
 {
-    constexpr usz SECTOR_SIZE = 0x200;
+    constexpr u32 READAHEAD_SECTORS = 8;
 
     typedef enum DISK_MODES
     {
@@ -36,30 +47,114 @@ namespace cosmovm
         WRITE = 1,
     }DISK_MODES;
 
+    typedef enum DISK_STATUS
+    {
+        READY = 0,
+        BUSY = 1,
+        FAILED = 2,
+    }DISK_STATUS;
+
+    typedef struct disk_request
+    {
+        u16 drive;
+        DISK_MODES mode;
+        u32 lba;
+        u32 count;
+        bool dma;
+        bool flush;
+    }disk_request;
+
     class disk
     {
         private:
-            std::size_t m_file_size;
             DISK_MODES m_mode;
-            u16 m_lba;
+            u32 m_lba;
+            // High word of the next LBA, cleared once set_lba uses it
+            u16 m_lba_high;
             std::array<u8, SECTOR_SIZE> m_buf;
             u16 m_buf_index;
 
-            std::fstream m_file;
+            std::vector<std::unique_ptr<disk_image>> m_images;
+            u16 m_drive;
             std::shared_ptr<bus>& m_bus;
 
+            // DMA moves whole sectors between the image and memory
+            u16 m_dma_addr;
+            u16 m_dma_count;
+            std::vector<u8> m_dma_buf;
+            bool m_dma_commit;
+
+            // Async mode, the worker owns the image and m_buf while a request is queued
+            bool m_async;
+            std::thread m_worker;
+            std::mutex m_mutex;
+            std::condition_variable m_request_cv;
+            std::condition_variable m_done_cv;
+            std::optional<disk_request> m_request;
+            DISK_STATUS m_status;
+            bool m_quit;
+            // Sectors following a sequential read, dropped when written
+            std::map<u32, std::array<u8, SECTOR_SIZE>> m_readahead;
+            u16 m_readahead_drive;
+            u32 m_readahead_next;
+            u32 m_readahead_end;
+            u32 m_last_read_lba;
+
         public:
             disk() = delete;
+            disk(const disk&) = delete;
             disk(std::shared_ptr<bus>& bus, const std::string& disk_path);
+            disk(std::shared_ptr<bus>& bus, std::unique_ptr<disk_image> image, bool async = false);
+            disk(std::shared_ptr<bus>& bus, std::vector<std::unique_ptr<disk_image>> images, bool async = false);
             ~disk();
 
-            u16 set_mode(u16 mode);
-            u16 set_lba(u16 lba);
-            u16 do_it(u16 dummy);
+            void set_mode(u16 mode);
+            void set_lba(u16 lba);
+            void do_it(u16 data);
 
-            u16 request_read_write(u16 data_in);
-            u16 get_sectors_count(u16 dummy);
-            u16 end(u16 dummy);
+            u16 get_byte();
+            void put_byte(u16 data);
+            u16 get_sectors_count();
+            u16 end();
+            u16 get_status();
+
+            void set_dma_addr(u16 addr);
+            void set_dma_count(u16 count);
+            void dma_start(u16 data);
+            void flush(u16 data);
+
+            void select_drive(u16 drive);
+            void set_lba_high(u16 lba_high);
+            u16 get_sectors_count_high();
+            u16 get_drive_count();
+
+            static constexpr std::array<port_descriptor<disk>, 15> PORTS =
+            {{
+                {0x61, nullptr, &disk::set_mode},
+                {0x62, nullptr, &disk::set_lba},
+                {0x63, nullptr, &disk::do_it},
+                {0x64, &disk::get_byte, &disk::put_byte},
+                {0x65, &disk::get_sectors_count, nullptr},
+                {0x66, &disk::end, nullptr},
+                {0x67, &disk::get_status, nullptr},
+                {0x68, nullptr, &disk::set_dma_addr},
+                {0x69, nullptr, &disk::set_dma_count},
+                {0x6A, nullptr, &disk::dma_start},
+                {0x6B, nullptr, &disk::flush},
+                {0x6C, nullptr, &disk::select_drive},
+                {0x6D, nullptr, &disk::set_lba_high},
+                {0x6E, &disk::get_sectors_count_high, nullptr},
+                {0x6F, &disk::get_drive_count, nullptr},
+            }};
+
+        private:
+            void wait_idle();
+            void submit(disk_request request);
+            void transfer(const disk_request& request);
+            // Image errors are reported and become DISK_STATUS::FAILED
+            bool try_transfer(const disk_request& request);
+            void commit_dma();
+            void worker_loop();
     };
 }
 
@@ -0,0 +1,89 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISK_IMAGE_HPP
+#define DISK_IMAGE_HPP
+
+#include <cstring>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "common.hpp"
+
+namespace cosmovm
+{
+    constexpr usz SECTOR_SIZE = 0x200;
+
+    typedef enum DISK_BACKENDS
+    {
+        STREAM = 0,     // std::fstream, one seek and read/write per sector
+        MMAP = 1,       // Mapped file, sectors are plain copies
+    }DISK_BACKENDS;
+
+    typedef enum SYNC_POLICY
+    {
+        SYNC_NONE = 0,          // Left to the host
+        SYNC_ON_SHUTDOWN = 1,   // Flushed when the image is closed
+        SYNC_ON_WRITE = 2,      // Flushed after every sector write
+    }SYNC_POLICY;
+
+    // Sector addressed storage behind a disk, writes past the end grow the image
+    class disk_image
+    {
+        public:
+            virtual ~disk_image() = default;
+
+            virtual void read(u32 lba, u8* buf) = 0;
+            virtual void write(u32 lba, const u8* buf) = 0;
+            virtual u32 get_sectors_count() = 0;
+            virtual void flush() = 0;
+    };
+
+    class stream_image : public disk_image
+    {
+        private:
+            std::fstream m_file;
+            // Same file, fstream can't ask the host to write it to the disk
+            int m_fd;
+            u32 m_sectors_count;
+            SYNC_POLICY m_sync;
+            bool m_read_only;
+
+        public:
+            stream_image() = delete;
+            stream_image(const stream_image&) = delete;
+            stream_image(const std::string& disk_path, SYNC_POLICY sync, bool read_only = false);
+            ~stream_image();
+
+            void read(u32 lba, u8* buf) override;
+            void write(u32 lba, const u8* buf) override;
+            u32 get_sectors_count() override;
+            void flush() override;
+    };
+
+    // Overlay images are recognized by their header, the backend then applies to their base
+    std::unique_ptr<disk_image> open_disk_image(
+        const std::string& disk_path,
+        DISK_BACKENDS backend = DISK_BACKENDS::STREAM,
+        SYNC_POLICY sync = SYNC_POLICY::SYNC_NONE,
+        bool read_only = false);
+}
+
+#endif /* DISK_IMAGE_HPP */
\ No newline at end of file
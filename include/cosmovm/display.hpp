@@ -19,59 +19,133 @@
 #ifndef DISPLAY_HPP
 #define DISPLAY_HPP
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <future>
 #include <memory>
-
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_ttf.h>
+#include <thread>
+#include <vector>
 
 #include "common.hpp"
 #include "bus.hpp"
+#include "capture.hpp"
+#include "display_backend.hpp"
+#include "shm_framebuffer.hpp"
 
 namespace cosmovm
 {
-    constexpr std::string FONT_PATH = "vgafont.ttf";
-    constexpr u16 VIDEO_START_ADDR = 0xB500;
-    constexpr u16 VIDEO_MEM_SIZE   = 0x4B00;
-    constexpr u16 TEXT_MODE_W = 80;
-    constexpr u16 TEXT_MODE_H = 25;
-    constexpr u16 GFX_MODE_W = 160;
-    constexpr u16 GFX_MODE_H = 120;
-    constexpr u16 WINDOW_W = 640;
-    constexpr u16 WINDOW_H = 480;
-    constexpr u16 GFX_BIT_DEPTH = 8;
-
-    typedef enum VIDEO_MODES
+    // Video state at a frame boundary, what the render thread draws from
+    typedef struct frame_snapshot
     {
-        TEXT = 0,       // 80x25 MONOCHROME
-        GRAPHIC = 1,    // 320x240 8-bit color
-    }VIDEO_MODES;
+        VIDEO_MODES mode;
+        text_registers text;
+        std::array<u8, VIDEO_MEM_SIZE> vram;
+        gfx_rows dirty_rows;
+        // False when the guest left the screen as it was
+        bool changed;
+    }frame_snapshot;
 
     class display
     {
+        public:
+            // Called on the thread that renders, SDL wants its window there
+            typedef std::function<std::unique_ptr<display_backend>()> backend_factory;
+
         private:
-            SDL_Window* m_window;
-            SDL_Renderer* m_renderer;
-            SDL_Color m_color;
-            TTF_Font* m_font;
+            std::unique_ptr<display_backend> m_backend;
+            text_screen m_text_screen;
+            // Tile mode sends the rows that differ from the last composed frame
+            std::array<u8, GFX_MODE_W * GFX_MODE_H> m_tile_pixels;
+            std::array<u8, GFX_MODE_W * GFX_MODE_H> m_shown_tiles;
+            VIDEO_MODES m_drawn_mode;
+            // Graphic mode only hands the rows written since the last frame to the backend
+            usz m_vram_tracker;
+            std::vector<u32> m_dirty_pages;
+
+            // Triple buffer: the emulation thread fills m_back, the render thread
+            // draws m_front and they swap with m_middle, tagged when it holds a new frame
+            bool m_threaded;
+            std::array<frame_snapshot, 3> m_frames;
+            std::atomic<u8> m_middle;
+            u8 m_back;
+            u8 m_front;
+            std::thread m_render_thread;
+
+            // Frames are only presented when VRAM, the mode or the registers changed
+            VIDEO_MODES m_last_mode;
+            text_registers m_last_text;
+            u16 m_last_page;
+            u16 m_frame_counter;
+            bool m_vsync_wait;
+            usz m_presented;
+            usz m_skipped;
+            usz m_dropped;
+            // Gets every frame where the guest changed the screen
+            std::unique_ptr<frame_capture> m_capture;
+            // Gets every presented frame, drawn on the thread that renders
+            std::unique_ptr<shm_framebuffer> m_shm;
 
             std::shared_ptr<bus>& m_bus;
-            std::array<u8, MEM_SIZE>::const_iterator m_video_mem_buf;
-            bool m_quit;
+            // The page shown, the one asked for is latched at the next frame boundary
+            u16 m_page;
+            u16 m_next_page;
+            const u8* m_video_mem_buf;
+            std::atomic<bool> m_quit;
             VIDEO_MODES m_mode;
+            text_registers m_text;
 
         public:
+#ifdef COSMOVM_SDL
+            // Opens a window through sdl_backend
             display(std::shared_ptr<bus>& bus, const std::string& window_title);
+#endif
+            display(std::shared_ptr<bus>& bus, const backend_factory& factory, bool render_thread = false);
             display(const display&) = delete;
             display() = delete;
             ~display();
 
+            // Draws the frame, or hands it to the render thread and returns
             void run();
             bool window_is_open();
-            u16 change_mode(u16 mode);
+            void change_mode(u16 mode);
+            u16 get_frame_counter();
+            // Text mode scrolling, cursor and colors
+            void set_text_start(u16 start);
+            u16 get_text_start();
+            void set_text_cursor(u16 cursor);
+            u16 get_text_cursor();
+            void set_text_attributes(u16 enabled);
+            u16 get_text_attributes();
+            void set_page(u16 page);
+            // The page shown, a flip is done once it reads back
+            u16 get_page();
+            // Ends the cpu time slice of the current frame
+            void wait_vsync(u16 unused);
+            bool waiting_vsync();
+            // Draws the last frame handed over and stops the render thread,
+            // the backend is destroyed on it
+            void finish();
+            void attach_capture(std::unique_ptr<frame_capture> capture);
+            // Before run is first called
+            void attach_shm(std::unique_ptr<shm_framebuffer> shm);
+            display_backend& get_backend();
+
+            static constexpr std::array<port_descriptor<display>, 6> PORTS =
+            {{
+                {0x44, nullptr, &display::change_mode},
+                {0x45, &display::get_frame_counter, &display::wait_vsync},
+                {0x46, &display::get_text_start, &display::set_text_start},
+                {0x47, &display::get_text_cursor, &display::set_text_cursor},
+                {0x48, &display::get_text_attributes, &display::set_text_attributes},
+                {0x49, &display::get_page, &display::set_page},
+            }};
 
         private:
-            void render_text_mode();
-            void render_graphic_mode();
+            bool collect_dirty_rows(gfx_rows& dirty_rows);
+            void render_loop(const backend_factory& factory, std::promise<void> ready);
+            void draw_frame(display_backend& target, VIDEO_MODES mode, const u8* pixels, const gfx_rows& rows);
+            void present(VIDEO_MODES mode, const text_registers& text, const u8* vram, const gfx_rows& dirty_rows, bool changed);
     };
 }
 
@@ -0,0 +1,171 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISPLAY_BACKEND_HPP
+#define DISPLAY_BACKEND_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+namespace cosmovm
+{
+    // Optional, the SDL window draws text with the built-in VGA_FONT unless a TTF is given
+    constexpr std::string FONT_PATH = "vgafont.ttf";
+    constexpr u16 VIDEO_START_ADDR = 0xB500;
+    constexpr u16 VIDEO_MEM_SIZE   = 0x4B00;
+    // Page 0 is at VIDEO_START_ADDR, the others are stacked below it
+    constexpr u16 VIDEO_PAGES = VIDEO_START_ADDR / VIDEO_MEM_SIZE + 1;
+    constexpr u16 TEXT_MODE_W = 80;
+    constexpr u16 TEXT_MODE_H = 25;
+    constexpr u16 GFX_MODE_W = 160;
+    constexpr u16 GFX_MODE_H = 120;
+    constexpr u16 WINDOW_W = 640;
+    constexpr u16 WINDOW_H = 480;
+    constexpr u16 GFX_BIT_DEPTH = 8;
+    // Graphic pixels are squares of GFX_SCALE window pixels
+    constexpr u16 GFX_SCALE = WINDOW_W / GFX_MODE_W;
+    // Text mode draws from an atlas of 16x16 glyphs into a grid of cells
+    constexpr u16 TEXT_CELL_W = 8;
+    constexpr u16 TEXT_CELL_H = 16;
+    constexpr u16 ATLAS_COLUMNS = 16;
+    constexpr u16 GLYPH_COUNT = 256;
+    // Text VRAM is a ring of lines the screen starts anywhere in, followed
+    // by one attribute byte per cell (low nibble foreground, high background)
+    constexpr u16 TEXT_RING_LINES = 120;
+    constexpr u16 TEXT_RING_CELLS = TEXT_MODE_W * TEXT_RING_LINES;
+    constexpr u16 TEXT_ATTR_OFFSET = TEXT_RING_CELLS;
+    constexpr u16 TEXT_CURSOR_HIDDEN = 0xFFFF;
+    // Underline cursor, last lines of the cell
+    constexpr u16 TEXT_CURSOR_LINES = 2;
+    // Colors without the attribute plane
+    constexpr u32 TEXT_FOREGROUND = 0xDFDFDFFF;
+    constexpr u32 TEXT_BACKGROUND = 0x000000FF;
+
+    // Tile mode VRAM: a map of 2 byte entries (tile, palette), 4 color
+    // RGB332 palettes and 2 bits per pixel tiles, 2 bytes per row
+    constexpr u16 TILE_SIZE = 8;
+    constexpr u16 TILE_MAP_W = GFX_MODE_W / TILE_SIZE;
+    constexpr u16 TILE_MAP_H = GFX_MODE_H / TILE_SIZE;
+    constexpr u16 TILE_MAP_OFFSET = 0x0000;
+    constexpr u16 TILE_PALETTE_OFFSET = 0x0400;
+    constexpr u16 TILE_PALETTES = 16;
+    constexpr u16 TILE_PALETTE_COLORS = 4;
+    constexpr u16 TILESET_OFFSET = 0x0800;
+    constexpr u16 TILE_BYTES = TILE_SIZE * 2;
+
+    // 16 color VGA palette, RGBA8888
+    constexpr std::array<u32, 16> VGA_PALETTE =
+    {{
+        0x000000FF, 0x0000AAFF, 0x00AA00FF, 0x00AAAAFF, 0xAA0000FF, 0xAA00AAFF, 0xAA5500FF, 0xAAAAAAFF,
+        0x555555FF, 0x5555FFFF, 0x55FF55FF, 0x55FFFFFF, 0xFF5555FF, 0xFF55FFFF, 0xFFFF55FF, 0xFFFFFFFF,
+    }};
+
+    constexpr u16 video_page_addr(u16 page)
+    {
+        return VIDEO_START_ADDR - page * VIDEO_MEM_SIZE;
+    }
+
+    typedef enum VIDEO_MODES
+    {
+        TEXT = 0,       // 80x25 MONOCHROME
+        GRAPHIC = 1,    // 320x240 8-bit color
+        TILE = 2,       // 20x15 map of 8x8 tiles, composed to the graphic mode
+    }VIDEO_MODES;
+
+    typedef enum DISPLAY_BACKENDS
+    {
+        DISPLAY_SDL = 0,        // Window through SDL2
+        DISPLAY_HEADLESS = 1,   // In-memory framebuffer, no SDL video
+        DISPLAY_ANSI = 2,       // Text mode on the terminal, no SDL video
+    }DISPLAY_BACKENDS;
+
+    // Text controller state, set through the display ports
+    typedef struct text_registers
+    {
+        u16 start{0};       // Ring cell shown at the top left
+        u16 cursor{TEXT_CURSOR_HIDDEN};
+        bool attributes{false};
+
+        bool operator==(const text_registers&) const = default;
+    }text_registers;
+
+    // What a backend draws in text mode, in screen order
+    typedef struct text_screen
+    {
+        std::array<u8, TEXT_MODE_W * TEXT_MODE_H> glyphs;
+        std::array<u8, TEXT_MODE_W * TEXT_MODE_H> attrs;
+        u16 cursor;
+        bool attributes;
+
+        u32 foreground(u16 cell) const
+        {
+            return attributes ? VGA_PALETTE[attrs[cell] & 0xF] : TEXT_FOREGROUND;
+        }
+
+        u32 background(u16 cell) const
+        {
+            return attributes ? VGA_PALETTE[attrs[cell] >> 4] : TEXT_BACKGROUND;
+        }
+
+        // False when the cell looks different on the other screen
+        bool same_cell(const text_screen& other, u16 cell) const
+        {
+            return glyphs[cell] == other.glyphs[cell]
+                && foreground(cell) == other.foreground(cell)
+                && background(cell) == other.background(cell)
+                && (cursor == cell) == (other.cursor == cell);
+        }
+    }text_screen;
+    typedef std::array<bool, GFX_MODE_H> gfx_rows;
+
+    // Where the display device sends its frames, a backend keeps whatever
+    // it needs to redraw only what changed between two calls
+    class display_backend
+    {
+        public:
+            virtual ~display_backend() = default;
+
+            // False once the user asked to close the display
+            virtual bool poll_events() = 0;
+            virtual void render_text(const text_screen& screen) = 0;
+            // dirty_rows lists the rows written since the previous graphic frame
+            virtual void render_graphic(const u8* pixels, const gfx_rows& dirty_rows) = 0;
+            // True when what was presented got lost (ex: window exposed) and the
+            // next frame has to be drawn even if the guest changed nothing
+            virtual bool damaged()
+            {
+                return false;
+            }
+    };
+
+    // Reads the screen out of the ring. Without the attribute plane, cells
+    // after the first NUL are blank like the string renderer did
+    void resolve_text_screen(const u8* vram, const text_registers& registers, text_screen& screen);
+
+    // Draws the tile map into a GFX_MODE_W x GFX_MODE_H RGB332 buffer
+    void compose_tiles(const u8* vram, u8* pixels);
+
+    // GLYPH_COUNT glyphs of the built-in font stretched to TEXT_CELL_W x TEXT_CELL_H,
+    // one byte per pixel set where the glyph is lit. Glyph 0 stays blank
+    std::vector<u8> render_glyph_mask();
+}
+
+#endif /* DISPLAY_BACKEND_HPP */
\ No newline at end of file
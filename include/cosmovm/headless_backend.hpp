@@ -0,0 +1,64 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HEADLESS_BACKEND_HPP
+#define HEADLESS_BACKEND_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "display_backend.hpp"
+
+namespace cosmovm
+{
+    // Renders into a WINDOW_W x WINDOW_H framebuffer in memory with the
+    // built-in font, it builds and runs without SDL
+    class headless_backend : public display_backend
+    {
+        private:
+            // RGBA8888, one u32 per pixel with red in the high byte
+            std::vector<u32> m_framebuffer;
+            // From render_glyph_mask
+            std::vector<u8> m_glyphs;
+            // Screen as last drawn
+            text_screen m_text_shadow;
+            VIDEO_MODES m_drawn_mode;
+            bool m_redraw;
+            usz m_frames;
+            std::string m_dump_path;
+
+        public:
+            // A non empty dump_path gets the last frame when the backend is destroyed
+            headless_backend(const std::string& dump_path = "");
+            headless_backend(const headless_backend&) = delete;
+            ~headless_backend();
+
+            bool poll_events() override;
+            void render_text(const text_screen& screen) override;
+            void render_graphic(const u8* pixels, const gfx_rows& dirty_rows) override;
+
+            const std::vector<u32>& get_framebuffer() const;
+            usz get_frames_count() const;
+            // Binary PPM (P6) of the last rendered frame
+            void dump_ppm(const std::string& path) const;
+    };
+}
+
+#endif /* HEADLESS_BACKEND_HPP */
\ No newline at end of file
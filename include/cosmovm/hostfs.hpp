@@ -0,0 +1,118 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HOSTFS_HPP
+#define HOSTFS_HPP
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "bus.hpp"
+
+namespace cosmovm
+{
+    constexpr u16 HOSTFS_MAX_HANDLES = 16;
+    constexpr u16 HOSTFS_MAX_PATH = 0x100;
+
+    typedef enum HOSTFS_COMMANDS
+    {
+        HOSTFS_OPEN = 0,    // Existing file for reading and writing (or only reading), path at address
+        HOSTFS_CREATE = 1,  // New or truncated file, path at address
+        HOSTFS_READ = 2,    // Up to length bytes from the file to address
+        HOSTFS_WRITE = 3,   // Length bytes from address to the file
+        HOSTFS_SEEK = 4,    // Absolute position from the offset ports
+        HOSTFS_CLOSE = 5,
+    }HOSTFS_COMMANDS;
+
+    typedef enum HOSTFS_STATUS
+    {
+        HOSTFS_OK = 0,
+        HOSTFS_NOT_FOUND = 1,
+        HOSTFS_DENIED = 2,
+        HOSTFS_BAD_HANDLE = 3,
+        HOSTFS_BAD_ADDRESS = 4,
+        HOSTFS_IO_ERROR = 5,
+        HOSTFS_BAD_COMMAND = 6,
+        HOSTFS_BAD_PATH = 7,    // No NUL in HOSTFS_MAX_PATH bytes
+    }HOSTFS_STATUS;
+
+    // Files of a host directory, the guest can't reach outside of it
+    class hostfs
+    {
+        private:
+            std::shared_ptr<bus>& m_bus;
+            std::filesystem::path m_root;
+            std::array<std::fstream, HOSTFS_MAX_HANDLES> m_files;
+            // Opened without write permission
+            std::array<bool, HOSTFS_MAX_HANDLES> m_read_only;
+
+            u16 m_handle;
+            u16 m_addr;
+            u16 m_length;
+            u32 m_offset;
+            HOSTFS_STATUS m_status;
+            // Bytes moved by the last read or write
+            u16 m_transferred;
+            std::vector<u8> m_buf;
+
+        public:
+            hostfs() = delete;
+            hostfs(const hostfs&) = delete;
+            hostfs(std::shared_ptr<bus>& bus, const std::string& root);
+            ~hostfs();
+
+            void run_command(u16 command);
+            void set_handle(u16 handle);
+            u16 get_handle();
+            void set_addr(u16 addr);
+            void set_length(u16 length);
+            u16 get_transferred();
+            void set_offset_low(u16 offset);
+            void set_offset_high(u16 offset);
+            u16 get_offset_low();
+            u16 get_offset_high();
+            u16 get_status();
+
+            static constexpr std::array<port_descriptor<hostfs>, 7> PORTS =
+            {{
+                {0x81, nullptr, &hostfs::run_command},
+                {0x82, &hostfs::get_handle, &hostfs::set_handle},
+                {0x83, nullptr, &hostfs::set_addr},
+                {0x84, &hostfs::get_transferred, &hostfs::set_length},
+                {0x85, &hostfs::get_offset_low, &hostfs::set_offset_low},
+                {0x86, &hostfs::get_offset_high, &hostfs::set_offset_high},
+                {0x87, &hostfs::get_status, nullptr},
+            }};
+
+        private:
+            HOSTFS_STATUS open(bool create);
+            HOSTFS_STATUS read();
+            HOSTFS_STATUS write();
+            HOSTFS_STATUS seek();
+            HOSTFS_STATUS close();
+            bool resolve(std::filesystem::path& path);
+            std::fstream* current_file();
+    };
+}
+
+#endif /* HOSTFS_HPP */
\ No newline at end of file
@@ -19,6 +19,8 @@
 #ifndef KEYBOARD_HPP
 #define KEYBOARD_HPP
 
+#include <array>
+
 #include <SDL2/SDL_keyboard.h>
 
 #include "common.hpp"
@@ -40,9 +42,16 @@ namespace cosmovm
             keyboard(std::shared_ptr<bus>& bus);
             ~keyboard();
 
-            u16 set_key_selector(u16 key_selector);
-            u16 get_requested_key(u16 dummy);
-            u16 get_pressed_key(u16 dummy);
+            void set_key_selector(u16 key_selector);
+            u16 get_requested_key();
+            u16 get_pressed_key();
+
+            static constexpr std::array<port_descriptor<keyboard>, 3> PORTS =
+            {{
+                {0x51, nullptr, &keyboard::set_key_selector},
+                {0x52, &keyboard::get_requested_key, nullptr},
+                {0x53, &keyboard::get_pressed_key, nullptr},
+            }};
     };
 }
 
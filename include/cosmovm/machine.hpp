@@ -0,0 +1,169 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MACHINE_HPP
+#define MACHINE_HPP
+
+#include <array>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#include "common.hpp"
+#include "bus.hpp"
+#include "memory.hpp"
+
+namespace cosmovm
+{
+    // A fixed set of devices whose port map is known at compile time, IN/OUT
+    // resolve to a chain of constant compares the compiler turns into a switch.
+    // Ports bound on the bus at runtime (ex: mmu) are still reached through it
+    template<typename Cpu, typename... Devices>
+    class machine
+    {
+        private:
+            std::shared_ptr<memory> m_memory;
+            std::shared_ptr<bus> m_bus;
+            std::tuple<std::unique_ptr<Devices>...> m_devices;
+            std::unique_ptr<Cpu> m_cpu;
+
+            static constexpr bool ports_unique()
+            {
+                std::array<u16, (Devices::PORTS.size() + ... + 0)> ports{};
+                usz count = 0;
+                ([&]()
+                {
+                    for (const auto& desc : Devices::PORTS)
+                        ports[count++] = desc.port;
+                }(), ...);
+                for (usz i = 0; i < ports.size(); i++)
+                    for (usz j = i + 1; j < ports.size(); j++)
+                        if (ports[i] == ports[j])
+                            return false;
+                return true;
+            }
+
+            static_assert(ports_unique(), "[MACHINE] Two devices share a port");
+
+        public:
+            machine() = delete;
+            machine(const machine&) = delete;
+            machine& operator=(const machine&) = delete;
+
+            // One tuple of constructor arguments per device, the bus is passed first
+            template<typename... Args>
+            machine(std::shared_ptr<memory> memory_ref, Args&&... device_args)
+            :
+            m_memory(memory_ref),
+            m_bus(std::make_shared<bus>(m_memory)),
+            m_devices(make_device<Devices>(std::forward<Args>(device_args))...),
+            m_cpu(std::make_unique<Cpu>(m_bus))
+            {
+                static_assert(sizeof...(Args) == sizeof...(Devices), "[MACHINE] Missing device arguments");
+                m_cpu->attach_io(&machine::dispatch_in, &machine::dispatch_out, this);
+            }
+
+            Cpu& get_cpu()
+            {
+                return *m_cpu;
+            }
+
+            template<typename Device>
+            Device& get()
+            {
+                return *std::get<std::unique_ptr<Device>>(m_devices);
+            }
+
+            std::shared_ptr<bus>& get_bus()
+            {
+                return m_bus;
+            }
+
+            const std::shared_ptr<memory>& get_memory() const
+            {
+                return m_memory;
+            }
+
+            static u16 dispatch_in(void* ctx, u16 port)
+            {
+                machine* self = static_cast<machine*>(ctx);
+                u16 value = 0;
+                if ((self->template device_in<Devices>(port, value, std::make_index_sequence<Devices::PORTS.size()>{}) || ...))
+                    return value;
+                return self->m_bus->device_in(port);
+            }
+
+            static void dispatch_out(void* ctx, u16 port, u16 data)
+            {
+                machine* self = static_cast<machine*>(ctx);
+                if ((self->template device_out<Devices>(port, data, std::make_index_sequence<Devices::PORTS.size()>{}) || ...))
+                    return;
+                self->m_bus->device_out(port, data);
+            }
+
+        private:
+            template<typename Device, typename Args>
+            std::unique_ptr<Device> make_device(Args&& args)
+            {
+                return std::apply([this](auto&&... arg)
+                {
+                    return std::make_unique<Device>(m_bus, std::forward<decltype(arg)>(arg)...);
+                }, std::forward<Args>(args));
+            }
+
+            template<typename Device, usz... I>
+            bool device_in(u16 port, u16& value, std::index_sequence<I...>)
+            {
+                return (try_in<Device, I>(port, value) || ...);
+            }
+
+            template<typename Device, usz... I>
+            bool device_out(u16 port, u16 data, std::index_sequence<I...>)
+            {
+                return (try_out<Device, I>(port, data) || ...);
+            }
+
+            template<typename Device, usz I>
+            bool try_in(u16 port, u16& value)
+            {
+                constexpr port_descriptor<Device> DESC = Device::PORTS[I];
+                if constexpr (DESC.in != nullptr) {
+                    if (port == DESC.port) {
+                        value = (get<Device>().*DESC.in)();
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            template<typename Device, usz I>
+            bool try_out(u16 port, u16 data)
+            {
+                constexpr port_descriptor<Device> DESC = Device::PORTS[I];
+                if constexpr (DESC.out != nullptr) {
+                    if (port == DESC.port) {
+                        (get<Device>().*DESC.out)(data);
+                        return true;
+                    }
+                }
+                return false;
+            }
+    };
+}
+
+#endif /* MACHINE_HPP */
\ No newline at end of file
@@ -31,14 +31,39 @@ namespace cosmovm
     constexpr u32 MEM_SIZE = 0x10000;
     constexpr std::string DUMP_PATH = "mem_dump.bin";
 
+    // 16 KiB windows of the 16-bit address space, each mapped to a physical bank
+    constexpr u32 BANK_SIZE = 0x4000;
+    constexpr u32 BANK_SHIFT = 14;
+    constexpr u32 BANK_MASK = BANK_SIZE - 1;
+    constexpr u16 WINDOW_COUNT = MEM_SIZE / BANK_SIZE;
+    constexpr u32 MAX_PHYS_MEM_SIZE = 0x1000000; // 16 MiB
+
+    // Granularity of write tracking
+    constexpr u32 PAGE_SIZE = 0x100;
+    constexpr u32 PAGE_SHIFT = 8;
+
+    // Pages written since the consumer last cleared them
+    typedef struct dirty_tracker
+    {
+        std::vector<u64> pages;
+        // Clears so far, pages marked in epoch N were written after its N-th clear
+        u64 epoch;
+    }dirty_tracker;
+
     class memory
     {
         private:
-            std::array<u8, MEM_SIZE> m_mem_buf;
+            std::vector<u8> m_mem_buf;
+            // Physical base address of each window
+            std::array<u32, WINDOW_COUNT> m_windows;
+            // One bit per physical page, shared by writes until the next collection
+            std::vector<u64> m_dirty;
+            std::vector<dirty_tracker> m_trackers;
 
         public:
             memory();
             memory(u16 addr, const std::vector<u8>& buf, u16 sz);
+            memory(u32 phys_size, u16 addr, const std::vector<u8>& buf, u16 sz);
             ~memory();
 
             u8 read8(u16 addr);
@@ -46,9 +71,27 @@ namespace cosmovm
             void write8(u16 addr, u8 data);
             void write16(u16 addr, u16 data);
             void load(u16 addr, const std::vector<u8>& buf, u16 sz);
-            const std::array<u8, MEM_SIZE>& get_buf() const;
+            // Bulk copies through the windows, for DMA
+            void read_block(u16 addr, u8* buf, u32 size);
+            void write_block(u16 addr, const u8* buf, u32 size);
+            const std::vector<u8>& get_buf() const;
+
+            void map_window(u16 window, u16 bank);
+            u16 get_window_bank(u16 window) const;
+            u16 get_bank_count() const;
+
+            usz add_dirty_tracker();
+            void get_dirty_pages(usz tracker, std::vector<u32>& pages);
+            void clear_dirty(usz tracker);
+            u64 get_dirty_epoch(usz tracker) const;
 
             void dump();
+
+        private:
+            u32 translate(u32 addr) const;
+            void mark_dirty(u32 phys_addr);
+            void mark_dirty(u32 phys_addr, u32 size);
+            void collect_dirty();
     };
 }
 
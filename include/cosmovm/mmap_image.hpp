@@ -0,0 +1,64 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MMAP_IMAGE_HPP
+#define MMAP_IMAGE_HPP
+
+#include <string>
+
+#include "common.hpp"
+#include "disk_image.hpp"
+
+namespace cosmovm
+{
+#ifndef _WIN32
+    // Writes past the end grow the file by whole chunks, up to the image's size limit
+    constexpr usz MMAP_GROWTH_CHUNK = 0x100000;
+    constexpr u64 MMAP_MAX_SIZE = 0x100000000;
+
+    // The whole image is mapped shared, growing it remaps the file
+    class mmap_image : public disk_image
+    {
+        private:
+            int m_fd;
+            u8* m_map;
+            usz m_map_size;
+            // Bytes the guest wrote up to, the file past it is growth padding
+            usz m_size;
+            u64 m_max_size;
+            SYNC_POLICY m_sync;
+            bool m_read_only;
+
+        public:
+            mmap_image() = delete;
+            mmap_image(const mmap_image&) = delete;
+            mmap_image(const std::string& disk_path, SYNC_POLICY sync, bool read_only = false, u64 max_size = MMAP_MAX_SIZE);
+            ~mmap_image();
+
+            void read(u32 lba, u8* buf) override;
+            void write(u32 lba, const u8* buf) override;
+            u32 get_sectors_count() override;
+            void flush() override;
+
+        private:
+            void remap(usz size);
+    };
+#endif
+}
+
+#endif /* MMAP_IMAGE_HPP */
\ No newline at end of file
@@ -0,0 +1,56 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MMU_HPP
+#define MMU_HPP
+
+#include <array>
+
+#include "common.hpp"
+#include "bus.hpp"
+
+namespace cosmovm
+{
+    // Maps physical banks into the four 16 KiB windows of the address space
+    class mmu
+    {
+        private:
+            std::shared_ptr<bus>& m_bus;
+
+        public:
+            mmu() = delete;
+            mmu(const mmu&) = delete;
+            mmu(std::shared_ptr<bus>& bus);
+            ~mmu();
+
+            template<u16 WINDOW>
+            void select_bank(u16 bank);
+            u16 get_bank_count();
+
+            static constexpr std::array<port_descriptor<mmu>, 5> PORTS =
+            {{
+                {0x71, nullptr, &mmu::select_bank<0>},
+                {0x72, nullptr, &mmu::select_bank<1>},
+                {0x73, nullptr, &mmu::select_bank<2>},
+                {0x74, nullptr, &mmu::select_bank<3>},
+                {0x75, &mmu::get_bank_count, nullptr},
+            }};
+    };
+}
+
+#endif /* MMU_HPP */
\ No newline at end of file
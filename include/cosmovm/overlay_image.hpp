@@ -0,0 +1,89 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OVERLAY_IMAGE_HPP
+#define OVERLAY_IMAGE_HPP
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "disk_image.hpp"
+
+namespace cosmovm
+{
+    constexpr std::string OVERLAY_MAGIC = "COSMOOVL";
+    constexpr u32 OVERLAY_VERSION = 1;
+    constexpr usz OVERLAY_HEADER_SIZE = 0x1000;
+    constexpr usz OVERLAY_PATH_SIZE = OVERLAY_HEADER_SIZE - 24;
+    // 32 GiB of sectors, keeps the in-memory table at 256 MiB
+    constexpr u32 OVERLAY_MAX_SECTORS = 0x4000000;
+
+    // Allocation table entries, anything else is a 1-based cluster index
+    constexpr u32 OVERLAY_BASE = 0;
+    constexpr u32 OVERLAY_ZERO = 0xFFFFFFFF;
+
+    // Layout: header, one u32 entry per sector, then one cluster per written sector
+    typedef struct overlay_header
+    {
+        char magic[8];
+        u32 version;
+        u32 sectors_count;
+        u64 data_offset;
+        char base_path[OVERLAY_PATH_SIZE];
+    }overlay_header;
+
+    static_assert(sizeof(overlay_header) == OVERLAY_HEADER_SIZE);
+
+    // Copy-on-write layer over a shared base image, which is only ever read
+    class overlay_image : public disk_image
+    {
+        private:
+            std::fstream m_file;
+            // Same file, fstream can't ask the host to write it to the disk
+            int m_fd;
+            std::unique_ptr<disk_image> m_base;
+            std::vector<u32> m_table;
+            u64 m_data_offset;
+            u32 m_clusters_count;
+            SYNC_POLICY m_sync;
+
+        public:
+            overlay_image() = delete;
+            overlay_image(const overlay_image&) = delete;
+            overlay_image(const std::string& overlay_path, DISK_BACKENDS base_backend, SYNC_POLICY sync);
+            ~overlay_image();
+
+            void read(u32 lba, u8* buf) override;
+            void write(u32 lba, const u8* buf) override;
+            u32 get_sectors_count() override;
+            void flush() override;
+
+            static bool is_overlay(const std::string& path);
+            // Only writes the header, the table is left as a hole
+            static void create(const std::string& overlay_path, const std::string& base_path, u32 sectors_count);
+
+        private:
+            void write_entry(u32 lba);
+            u64 cluster_offset(u32 cluster) const;
+    };
+}
+
+#endif /* OVERLAY_IMAGE_HPP */
\ No newline at end of file
@@ -0,0 +1,63 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIXEL_HPP
+#define PIXEL_HPP
+
+#include <array>
+
+#include "common.hpp"
+
+namespace cosmovm
+{
+    typedef enum PIXEL_KERNELS
+    {
+        KERNEL_SCALAR = 0,
+        KERNEL_SSSE3 = 1,   // 16 pixels per step with pshufb lookups
+        KERNEL_AVX2 = 2,    // 32 pixels per step
+    }PIXEL_KERNELS;
+
+    // 3 bits of red, 3 of green and 2 of blue expanded to 8 bits each,
+    // RGBA8888 with red in the high byte and an opaque alpha
+    constexpr std::array<u32, 256> RGB332_PALETTE = []()
+    {
+        std::array<u32, 256> palette{};
+        for (u32 color = 0; color < palette.size(); color++)
+        {
+            u32 r = ((color >> 5) & 0b111) * 0xFF / 0b111;
+            u32 g = ((color >> 2) & 0b111) * 0xFF / 0b111;
+            u32 b = (color & 0b11) * 0xFF / 0b11;
+            palette[color] = (r << 24) | (g << 16) | (b << 8) | 0xFF;
+        }
+        return palette;
+    }();
+
+    // Fastest kernel the host cpu runs
+    PIXEL_KERNELS best_pixel_kernel();
+
+    // Converts width x height RGB332 pixels to RGBA8888, every pixel becomes a
+    // scale x scale square. Pitches are in pixels, dst_pitch counts scaled ones.
+    // The SIMD kernels handle scales 1 and 4, others fall back to the LUT
+    void rgb332_to_rgba(
+        const u8* src, usz src_pitch,
+        u32* dst, usz dst_pitch,
+        u16 width, u16 height, u16 scale,
+        PIXEL_KERNELS kernel = best_pixel_kernel());
+}
+
+#endif /* PIXEL_HPP */
\ No newline at end of file
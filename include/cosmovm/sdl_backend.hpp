@@ -0,0 +1,59 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SDL_BACKEND_HPP
+#define SDL_BACKEND_HPP
+
+#include <string>
+
+#include <SDL2/SDL.h>
+
+#include "common.hpp"
+#include "display_backend.hpp"
+
+namespace cosmovm
+{
+    class sdl_backend : public display_backend
+    {
+        private:
+            SDL_Window* m_window;
+            SDL_Renderer* m_renderer;
+            SDL_Texture* m_glyph_atlas;
+            SDL_Texture* m_text_target;
+            // Screen as last drawn into m_text_target
+            text_screen m_text_shadow;
+            bool m_text_redraw;
+            // Graphic mode uploads only the rows written since the last frame
+            SDL_Texture* m_gfx_texture;
+            bool m_gfx_redraw;
+            bool m_damaged;
+
+        public:
+            sdl_backend(const std::string& window_title, const std::string& font_path = "");
+            sdl_backend(const sdl_backend&) = delete;
+            sdl_backend() = delete;
+            ~sdl_backend();
+
+            bool poll_events() override;
+            void render_text(const text_screen& screen) override;
+            void render_graphic(const u8* pixels, const gfx_rows& dirty_rows) override;
+            bool damaged() override;
+    };
+}
+
+#endif /* SDL_BACKEND_HPP */
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SECTOR_CACHE_HPP
+#define SECTOR_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "disk_image.hpp"
+
+namespace cosmovm
+{
+    typedef enum CACHE_POLICY
+    {
+        WRITE_THROUGH = 0,  // Writes reach the image immediately
+        FLUSH_ON_PORT = 1,  // Write-back, the guest flush port is the durability point
+        FLUSH_ON_EXIT = 2,  // Write-back, only evictions and shutdown reach the image
+    }CACHE_POLICY;
+
+    typedef struct cache_entry
+    {
+        u32 lba;
+        bool dirty;
+        std::array<u8, SECTOR_SIZE> data;
+    }cache_entry;
+
+    // LRU cache in front of any image, most recently used sectors first
+    class sector_cache : public disk_image
+    {
+        private:
+            std::unique_ptr<disk_image> m_image;
+            usz m_capacity;
+            CACHE_POLICY m_policy;
+            std::list<cache_entry> m_entries;
+            std::unordered_map<u32, std::list<cache_entry>::iterator> m_index;
+            u32 m_sectors_count;
+
+            u64 m_hits;
+            u64 m_misses;
+            u64 m_flushes;
+
+        public:
+            sector_cache() = delete;
+            sector_cache(const sector_cache&) = delete;
+            sector_cache(std::unique_ptr<disk_image> image, usz capacity, CACHE_POLICY policy);
+            ~sector_cache();
+
+            void read(u32 lba, u8* buf) override;
+            void write(u32 lba, const u8* buf) override;
+            u32 get_sectors_count() override;
+            void flush() override;
+
+        private:
+            cache_entry& lookup(u32 lba, bool fill);
+            void write_back(cache_entry& entry);
+            void write_back_all();
+    };
+}
+
+#endif /* SECTOR_CACHE_HPP */
\ No newline at end of file
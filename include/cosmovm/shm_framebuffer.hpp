@@ -0,0 +1,79 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHM_FRAMEBUFFER_HPP
+#define SHM_FRAMEBUFFER_HPP
+
+#include <atomic>
+#include <string>
+
+#include "common.hpp"
+#include "headless_backend.hpp"
+
+namespace cosmovm
+{
+    constexpr u32 SHM_MAGIC = 0x42465643;   // "CVFB"
+    constexpr u16 SHM_VERSION = 1;
+    constexpr u16 SHM_HEADER_SIZE = 64;
+
+    // Start of the segment, the pixels follow at header_size: WINDOW_W x WINDOW_H
+    // RGBA8888, one u32 per pixel with red in the high byte. A reader loads
+    // sequence, reads the pixels, then loads it again: the frame is whole when
+    // both loads are the same even number
+    typedef struct shm_header
+    {
+        u32 magic;
+        u16 version;
+        u16 header_size;
+        u16 width;
+        u16 height;
+        u32 pitch;                  // Bytes per row
+        std::atomic<u64> sequence;  // Odd while a frame is written
+        u64 frames;                 // Frames published
+    }shm_header;
+
+    static_assert(sizeof(shm_header) <= SHM_HEADER_SIZE);
+    static_assert(std::atomic<u64>::is_always_lock_free, "[SHM] The sequence has to work across processes");
+
+    // Publishes what the display draws into a POSIX shared memory segment,
+    // external viewers map it read-only. The segment is removed on destruction
+    class shm_framebuffer
+    {
+        private:
+            std::string m_name;
+            int m_fd;
+            u8* m_map;
+            usz m_map_size;
+            shm_header* m_header;
+            headless_backend m_screen;
+
+        public:
+            // A leading '/' is added to name when missing, the segment must not exist
+            shm_framebuffer(const std::string& name);
+            shm_framebuffer(const shm_framebuffer&) = delete;
+            shm_framebuffer() = delete;
+            ~shm_framebuffer();
+
+            // Where the display draws the frame before publish
+            display_backend& get_screen();
+            void publish();
+            const std::string& get_name() const;
+    };
+}
+
+#endif /* SHM_FRAMEBUFFER_HPP */
\ No newline at end of file
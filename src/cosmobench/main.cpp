@@ -0,0 +1,221 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define SDL_MAIN_HANDLED
+
+#include <cstdlib>
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include <cosmovm/bus.hpp>
+#include <cosmovm/display.hpp>
+#include <cosmovm/memory.hpp>
+#include <cosmovm/pixel.hpp>
+
+constexpr std::size_t DEFAULT_FRAMES = 600;
+
+// Average milliseconds per call of frame
+double time_frames(std::size_t frames, const std::function<void(std::size_t)>& frame)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < frames; i++) frame(i);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000 / frames;
+}
+
+// What display did before the glyph atlas and the streaming texture
+class legacy_renderer
+{
+    private:
+        SDL_Window* m_window;
+        SDL_Renderer* m_renderer;
+        TTF_Font* m_font;
+        const std::uint8_t* m_video_mem_buf;
+
+    public:
+        legacy_renderer(const std::uint8_t* video_mem_buf)
+        :
+        m_window(),
+        m_renderer(),
+        m_font(TTF_OpenFont(cosmovm::FONT_PATH.c_str(), 8)),
+        m_video_mem_buf(video_mem_buf)
+        {
+            SDL_CreateWindowAndRenderer(cosmovm::WINDOW_W, cosmovm::WINDOW_H, 0, &m_window, &m_renderer);
+            if (m_font == NULL)
+                throw std::invalid_argument(std::format("[BENCH] Couldn't find {}", cosmovm::FONT_PATH));
+        }
+
+        ~legacy_renderer()
+        {
+            TTF_CloseFont(m_font);
+            SDL_DestroyRenderer(m_renderer);
+            SDL_DestroyWindow(m_window);
+        }
+
+        void render_text_mode()
+        {
+            SDL_Color color = {0xDF, 0xDF, 0xDF, 0};
+            SDL_Surface* surface = TTF_RenderUTF8_Solid_Wrapped(
+                m_font, reinterpret_cast<const char*>(m_video_mem_buf), color, cosmovm::WINDOW_W);
+            SDL_Texture* texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+            SDL_Rect rect = {.x = 0, .y = 0, .w = surface->w, .h = static_cast<int>(surface->h * 2.125F)};
+            SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+            SDL_RenderClear(m_renderer);
+            SDL_RenderCopy(m_renderer, texture, NULL, &rect);
+            SDL_RenderPresent(m_renderer);
+            SDL_FreeSurface(surface);
+            SDL_DestroyTexture(texture);
+        }
+
+        void render_graphic_mode()
+        {
+            SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(
+                (void*)m_video_mem_buf,
+                cosmovm::GFX_MODE_W,
+                cosmovm::GFX_MODE_H,
+                cosmovm::GFX_BIT_DEPTH,
+                cosmovm::GFX_MODE_W,
+                0b11100000,
+                0b00011100,
+                0b00000011,
+                0b0);
+            SDL_Texture* texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+            SDL_Rect rect = {.x = 0, .y = 0, .w = cosmovm::WINDOW_W, .h = cosmovm::WINDOW_H};
+            SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+            SDL_RenderClear(m_renderer);
+            SDL_RenderCopy(m_renderer, texture, NULL, &rect);
+            SDL_RenderPresent(m_renderer);
+            SDL_FreeSurface(surface);
+            SDL_DestroyTexture(texture);
+        }
+};
+
+void bench_pixels(std::size_t frames)
+{
+    std::minstd_rand rng;
+    std::vector<std::uint8_t> pixels(cosmovm::GFX_MODE_W * cosmovm::GFX_MODE_H);
+    for (auto& pixel : pixels) pixel = rng();
+    std::vector<std::uint32_t> expected(cosmovm::WINDOW_W * cosmovm::WINDOW_H);
+    std::vector<std::uint32_t> framebuffer(cosmovm::WINDOW_W * cosmovm::WINDOW_H);
+    cosmovm::rgb332_to_rgba(pixels.data(), cosmovm::GFX_MODE_W, expected.data(), cosmovm::WINDOW_W,
+        cosmovm::GFX_MODE_W, cosmovm::GFX_MODE_H, cosmovm::GFX_SCALE, cosmovm::PIXEL_KERNELS::KERNEL_SCALAR);
+
+    // Full 160x120 to 640x480 frames, as many as the display could ask for
+    std::cout << std::format("[BENCH] RGB332 to RGBA8888 x{}, best kernel {}:",
+        cosmovm::GFX_SCALE, static_cast<int>(cosmovm::best_pixel_kernel())) << std::endl;
+    const std::array<std::pair<cosmovm::PIXEL_KERNELS, const char*>, 3> kernels = {{
+        {cosmovm::PIXEL_KERNELS::KERNEL_SCALAR, "scalar"},
+        {cosmovm::PIXEL_KERNELS::KERNEL_SSSE3, "ssse3"},
+        {cosmovm::PIXEL_KERNELS::KERNEL_AVX2, "avx2"}}};
+    for (const auto& [kernel, name] : kernels)
+    {
+        if (kernel > cosmovm::best_pixel_kernel())
+            continue;
+        double ms = time_frames(frames * 10, [&](std::size_t)
+        {
+            cosmovm::rgb332_to_rgba(pixels.data(), cosmovm::GFX_MODE_W, framebuffer.data(), cosmovm::WINDOW_W,
+                cosmovm::GFX_MODE_W, cosmovm::GFX_MODE_H, cosmovm::GFX_SCALE, kernel);
+        });
+        std::cout << std::format("\t{:<6} {:.4f} ms{}", name, ms, (framebuffer == expected) ? "" : " MISMATCH") << std::endl;
+    }
+}
+
+void bench_display(std::size_t frames)
+{
+    std::shared_ptr<cosmovm::memory> cmem = std::make_shared<cosmovm::memory>();
+    std::shared_ptr<cosmovm::bus> cbus = std::make_shared<cosmovm::bus>(cmem);
+    std::unique_ptr<cosmovm::display> cscr = std::make_unique<cosmovm::display>(cbus, "CosmoBench");
+    legacy_renderer legacy(cmem->get_buf().data() + cosmovm::VIDEO_START_ADDR);
+    std::minstd_rand rng;
+
+    // Text mode: a full screen of text, then one character changing per frame
+    for (std::uint16_t cell = 0; cell < cosmovm::TEXT_MODE_W * cosmovm::TEXT_MODE_H; cell++)
+        cmem->write8(cosmovm::VIDEO_START_ADDR + cell, 0x21 + cell % 0x5E);
+    auto text_write = [&](std::size_t i)
+    {
+        cmem->write8(cosmovm::VIDEO_START_ADDR + i % (cosmovm::TEXT_MODE_W * cosmovm::TEXT_MODE_H), 0x21 + rng() % 0x5E);
+    };
+    cscr->change_mode(cosmovm::VIDEO_MODES::TEXT);
+    std::cout << "[BENCH] Text mode, static screen:" << std::endl;
+    std::cout << std::format("\tbefore {:.3f} ms", time_frames(frames, [&](std::size_t) { legacy.render_text_mode(); })) << std::endl;
+    std::cout << std::format("\tafter  {:.3f} ms", time_frames(frames, [&](std::size_t) { cscr->run(); })) << std::endl;
+    std::cout << "[BENCH] Text mode, one cell changing per frame:" << std::endl;
+    std::cout << std::format("\tbefore {:.3f} ms", time_frames(frames, [&](std::size_t i) { text_write(i); legacy.render_text_mode(); })) << std::endl;
+    std::cout << std::format("\tafter  {:.3f} ms", time_frames(frames, [&](std::size_t i) { text_write(i); cscr->run(); })) << std::endl;
+
+    // Graphic mode: static, one scanline per frame, every pixel per frame
+    auto row_write = [&](std::size_t i)
+    {
+        std::uint16_t row = i % cosmovm::GFX_MODE_H;
+        for (std::uint16_t x = 0; x < cosmovm::GFX_MODE_W; x++)
+            cmem->write8(cosmovm::VIDEO_START_ADDR + row * cosmovm::GFX_MODE_W + x, rng());
+    };
+    auto full_write = [&](std::size_t)
+    {
+        for (std::uint16_t pixel = 0; pixel < cosmovm::GFX_MODE_W * cosmovm::GFX_MODE_H; pixel++)
+            cmem->write8(cosmovm::VIDEO_START_ADDR + pixel, rng());
+    };
+    cscr->change_mode(cosmovm::VIDEO_MODES::GRAPHIC);
+    std::cout << "[BENCH] Graphic mode, static screen:" << std::endl;
+    std::cout << std::format("\tbefore {:.3f} ms", time_frames(frames, [&](std::size_t) { legacy.render_graphic_mode(); })) << std::endl;
+    std::cout << std::format("\tafter  {:.3f} ms", time_frames(frames, [&](std::size_t) { cscr->run(); })) << std::endl;
+    std::cout << "[BENCH] Graphic mode, one scanline changing per frame:" << std::endl;
+    std::cout << std::format("\tbefore {:.3f} ms", time_frames(frames, [&](std::size_t i) { row_write(i); legacy.render_graphic_mode(); })) << std::endl;
+    std::cout << std::format("\tafter  {:.3f} ms", time_frames(frames, [&](std::size_t i) { row_write(i); cscr->run(); })) << std::endl;
+    std::cout << "[BENCH] Graphic mode, every pixel changing per frame:" << std::endl;
+    std::cout << std::format("\tbefore {:.3f} ms", time_frames(frames, [&](std::size_t i) { full_write(i); legacy.render_graphic_mode(); })) << std::endl;
+    std::cout << std::format("\tafter  {:.3f} ms", time_frames(frames, [&](std::size_t i) { full_write(i); cscr->run(); })) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args(argv, argv + argc);
+
+    try {
+        std::size_t frames = DEFAULT_FRAMES;
+        if (args.size() == 2) {
+            frames = std::stoul(args.at(1));
+        } else if (args.size() > 2) {
+            std::cout << std::format("\tUsage: {} [FRAMES]", args.at(0)) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        // Presentation is part of the frame, run with SDL_RENDER_VSYNC=0 to measure it alone
+        SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER);
+        TTF_Init();
+        bench_pixels(std::max<std::size_t>(frames, 1));
+        bench_display(std::max<std::size_t>(frames, 1));
+        TTF_Quit();
+        SDL_Quit();
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::exit(EXIT_SUCCESS);
+}
\ No newline at end of file
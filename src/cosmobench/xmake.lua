@@ -0,0 +1,17 @@
+target("cosmobench")
+    set_version("2.0.0")
+    set_kind("binary")
+    add_files("main.cpp")
+    add_includedirs(ROOT_DIR .. "include")
+    add_deps("cosmocore_static")
+    add_linkdirs(ROOT_DIR .. "build")
+    add_links("SDL2", "SDL2_ttf", "cosmovm")
+    add_options("sdl")
+    if is_plat("linux") then
+        add_syslinks("pthread", "rt")
+    end
+    local local_ROOT_DIR = ROOT_DIR
+    after_build(function (target)
+        os.cp(target:targetfile(), local_ROOT_DIR .. "build")
+    end)
+target_end()
\ No newline at end of file
@@ -22,6 +22,8 @@
 #include <fstream>
 #include <format>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -133,6 +135,7 @@ const std::unordered_map<std::string, std::pair<KEYWORD, ARG_TYPE>> TOKENS = {
     {"U8",     {ASM_TYPU8 , INF_INT}},
     {"I16",    {ASM_TYPI16, INF_INT}},
     {"U16",    {ASM_TYPU16, INF_INT}},
+    {"BANK",   {ASM_BANK  , IMM}},
 };
 
 std::vector<std::string> split(std::string input, const std::string& delimiter)
@@ -351,6 +354,7 @@ void assemble_instruction(
 void assemble_command(
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
+    std::map<std::uint16_t, std::uint16_t>& sections,
     std::vector<std::string>& arguments,
     std::string command,
     KEYWORD token,
@@ -477,6 +481,21 @@ void assemble_command(
                     }
                 }
                 break;
+            case ASM_BANK:
+                {
+                    // Following code is placed in the given physical bank
+                    auto try_as_int = int_literal(arguments.at(0));
+                    if (try_as_int.has_value() &&
+                        0 <= try_as_int.value() &&
+                        static_cast<std::uint32_t>(try_as_int.value()) < cosmovm::MAX_PHYS_MEM_SIZE / cosmovm::BANK_SIZE) {
+                        sections[bytecode.size()] = try_as_int.value();
+                    } else {
+                        throw std::invalid_argument(
+                            std::format("[ASSEMBLER] Line {}: Invalid bank {}",
+                                line_count, arguments.at(0)));
+                    }
+                }
+                break;
             default:
                 {
                     throw std::logic_error(
@@ -491,7 +510,8 @@ void assemble(
     std::string input,
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
-    std::unordered_map<std::uint16_t, std::string>& references)
+    std::unordered_map<std::uint16_t, std::string>& references,
+    std::map<std::uint16_t, std::uint16_t>& sections)
 {
     // Split by newline
     auto stmt_list = split(input, "\n");
@@ -555,7 +575,7 @@ void assemble(
         }
         // Assembler directive
         else if (BEGIN_ASM <= token && token < END) {
-            assemble_command(bytecode, addresses, arguments, command, token, line_count);
+            assemble_command(bytecode, addresses, sections, arguments, command, token, line_count);
         }
         else {
             throw std::logic_error(std::format("[ASSEMBLER] Line {}: Invalid directive/instruction {}", line_count, command));
@@ -605,6 +625,30 @@ void write_references(
     }
 }
 
+void write_references(
+    const std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>>& banked_references,
+    std::ofstream& ref_file)
+{
+    // Names outside bank 0 are tagged "BANK:NAME", bank 0 is written as without banks
+    for (const auto& [bank, references] : banked_references) {
+        for (const auto& ref: references) {
+            const std::string name = bank == 0 ? ref.second : std::format("{}:{}", bank, ref.second);
+            ref_file.write(reinterpret_cast<const char*>(&ref.first), sizeof(ref.first));
+            ref_file.write(name.data(), name.length() + 1);
+        }
+    }
+}
+
+void write_sections(
+    const std::map<std::uint16_t, std::uint16_t>& sections,
+    std::ofstream& bank_file)
+{
+    for (const auto& section: sections) {
+        bank_file.write(reinterpret_cast<const char*>(&section.first), sizeof(section.first));
+        bank_file.write(reinterpret_cast<const char*>(&section.second), sizeof(section.second));
+    }
+}
+
 void link_info(
     const std::unordered_map<std::string, std::uint16_t>& addresses,
     const std::unordered_map<std::uint16_t, std::string>& references)
@@ -623,7 +667,8 @@ void assemble(
     std::ifstream& asm_file,
     std::ofstream& code_file,
     std::ofstream& addr_file,
-    std::ofstream& ref_file)
+    std::ofstream& ref_file,
+    std::ofstream& bank_file)
 {
     std::size_t length = fsize(asm_file);
 
@@ -632,14 +677,16 @@ void assemble(
 
     std::unordered_map<std::string, std::uint16_t> addresses;
     std::unordered_map<std::uint16_t, std::string> references;
+    std::map<std::uint16_t, std::uint16_t> sections;
 
     asm_file.read(input.data(), length);
 
-    assemble(input, output, addresses, references);
+    assemble(input, output, addresses, references, sections);
 
     code_file.write(reinterpret_cast<const char*>(output.data()), output.size());
     write_addresses(addresses, addr_file);
     write_references(references, ref_file);
+    write_sections(sections, bank_file);
 }
 
 void read_addresses(
@@ -668,6 +715,19 @@ void read_references(
     }
 }
 
+void read_sections(
+    std::ifstream& bank_file,
+    std::map<std::uint16_t, std::uint16_t>& sections)
+{
+    while (bank_file.peek() != std::char_traits<char>::eof()) {
+        std::uint16_t addr;
+        std::uint16_t bank;
+        bank_file.read(reinterpret_cast<char*>(&addr), sizeof(addr));
+        bank_file.read(reinterpret_cast<char*>(&bank), sizeof(bank));
+        sections[addr] = bank;
+    }
+}
+
 void link(
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
@@ -693,19 +753,28 @@ void link(
     std::ifstream& code_file,
     std::ifstream& addr_file,
     std::ifstream& ref_file,
+    std::ifstream& bank_file,
     std::ofstream& bin_file)
 {
     std::size_t length = fsize(code_file);
 
-    std::vector<std::uint8_t> bytecode(length);
+    std::vector<std::tuple<
+        std::vector<std::uint8_t>,
+        std::unordered_map<std::string, std::uint16_t>,
+        std::unordered_map<std::uint16_t, std::string>,
+        std::map<std::uint16_t, std::uint16_t>>> objects;
+    objects.push_back({std::vector<std::uint8_t>(length), {}, {}, {}});
+
+    std::vector<std::uint8_t> bytecode;
     std::unordered_map<std::string, std::uint16_t> addresses;
-    std::unordered_map<std::uint16_t, std::string> references;
+    std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>> references;
 
-    code_file.read(reinterpret_cast<char*>(bytecode.data()), length);
-    read_addresses(addr_file, addresses);
-    read_references(ref_file, references);
+    code_file.read(reinterpret_cast<char*>(std::get<0>(objects.back()).data()), length);
+    read_addresses(addr_file, std::get<1>(objects.back()));
+    read_references(ref_file, std::get<2>(objects.back()));
+    read_sections(bank_file, std::get<3>(objects.back()));
 
-    link(bytecode, addresses, references);
+    link(objects, bytecode, addresses, references);
 
     bin_file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
 }
@@ -714,34 +783,56 @@ void link(
     const std::vector<std::tuple<
         std::vector<std::uint8_t>,
         std::unordered_map<std::string, std::uint16_t>,
-        std::unordered_map<std::uint16_t, std::string>>>& objects,
+        std::unordered_map<std::uint16_t, std::string>,
+        std::map<std::uint16_t, std::uint16_t>>>& objects,
     std::vector<std::uint8_t>& output_bytecode,
     std::unordered_map<std::string, std::uint16_t>& output_addr,
-    std::unordered_map<std::uint16_t, std::string>& output_ref)
+    std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>>& output_ref)
 {
     std::size_t addr_count = 0;
-    std::vector<std::uint16_t> relocation_offsets(objects.size() + 1);
 
-    relocation_offsets.push_back(0);
+    // Code and references of each physical bank, addresses are relative to the start of their bank
+    std::map<std::uint16_t, std::pair<
+        std::vector<std::uint8_t>,
+        std::unordered_map<std::uint16_t, std::string>>> banks;
+
+    for (const auto& [bytecode, addrs, refs, sections] : objects) {
+        // Objects start in bank 0 until a BANK directive
+        std::map<std::uint16_t, std::uint16_t> bounds = sections;
+        bounds.try_emplace(0, 0);
+
+        for (auto section = bounds.begin(); section != bounds.end(); ++section) {
+            const bool last = std::next(section) == bounds.end();
+            const std::size_t begin = section->first;
+            const std::size_t end = last ? bytecode.size() : std::next(section)->first;
+            auto& [bank_bytecode, bank_refs] = banks[section->second];
+
+            // Bank 0 keeps the whole address space, like code without BANK directive
+            const std::size_t limit = section->second == 0 ? cosmovm::MEM_SIZE : cosmovm::BANK_SIZE;
+            if (bank_bytecode.size() + (end - begin) > limit) {
+                throw std::invalid_argument(
+                    std::format("[LINKER] Bank {} is larger than 0x{:X} bytes", section->second, limit));
+            }
 
-    for (const auto& [bytecode, addrs, refs] : objects) {
-        // Concatenate addresses with relocation
-        output_addr.insert(addrs.begin(), addrs.end());
-        for (const auto& [name, addr] : addrs) {
-            output_addr.at(name) += relocation_offsets.back();
-        }
+            // Concatenate addresses with relocation
+            for (const auto& [name, addr] : addrs) {
+                if (begin <= addr && (addr < end || (last && addr == end))) {
+                    output_addr[name] = bank_bytecode.size() + (addr - begin);
+                }
+            }
 
-        // Concatenate references with relocation
-        for (const auto& [addr, name]: refs) {
-            output_ref[addr + relocation_offsets.back()] = name;
-        }
+            // Concatenate references with relocation
+            for (const auto& [addr, name] : refs) {
+                if (begin <= addr && addr < end) {
+                    bank_refs[bank_bytecode.size() + (addr - begin)] = name;
+                }
+            }
 
-        // Concatenate code
-        output_bytecode.insert(output_bytecode.end(), bytecode.begin(), bytecode.end());
+            // Concatenate code
+            bank_bytecode.insert(bank_bytecode.end(), bytecode.begin() + begin, bytecode.begin() + end);
+        }
 
-        // Setup next relocation offset
         addr_count += addrs.size();
-        relocation_offsets.push_back(relocation_offsets.back() + bytecode.size());
     }
 
     // Duplicate addresses
@@ -749,12 +840,35 @@ void link(
         throw std::invalid_argument("[LINKER] Duplicate location names");
     }
 
-    // Link all
-    link(output_bytecode, output_addr, output_ref);
+    // Link all, then place each bank at its physical address
+    for (auto bank = banks.begin(); bank != banks.end(); ++bank) {
+        auto& [index, bank_info] = *bank;
+        auto& [bank_bytecode, bank_refs] = bank_info;
+        const std::size_t base = static_cast<std::size_t>(index) * cosmovm::BANK_SIZE;
+
+        if (std::next(bank) != banks.end() &&
+            base + bank_bytecode.size() > std::next(bank)->first * cosmovm::BANK_SIZE) {
+            throw std::invalid_argument(
+                std::format("[LINKER] Bank {} overflows into bank {}", index, std::next(bank)->first));
+        }
+
+        if (banks.size() > 1) {
+            std::clog << std::format("[LINKER] Bank {}:", index) << std::endl;
+        }
+        link(bank_bytecode, output_addr, bank_refs);
+
+        output_bytecode.resize(base);
+        output_bytecode.insert(output_bytecode.end(), bank_bytecode.begin(), bank_bytecode.end());
+    }
+
+    // Banked references are relative to their own bank
+    for (const auto& [index, bank_info] : banks) {
+        output_ref[index] = bank_info.second;
+    }
 }
 
 void link(
-    std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream>>& object_files,
+    std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream, std::ifstream>>& object_files,
     std::ofstream& output_addr_file,
     std::ofstream& output_ref_file,
     std::ofstream& output_bin_file)
@@ -762,21 +876,23 @@ void link(
     std::vector<std::tuple<
         std::vector<std::uint8_t>,
         std::unordered_map<std::string, std::uint16_t>,
-        std::unordered_map<std::uint16_t, std::string>>> objects;
+        std::unordered_map<std::uint16_t, std::string>,
+        std::map<std::uint16_t, std::uint16_t>>> objects;
 
     std::vector<std::uint8_t> output_bytecode;
     std::unordered_map<std::string, std::uint16_t> output_addr;
-    std::unordered_map<std::uint16_t, std::string> output_ref;
+    std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>> output_ref;
 
     std::vector<std::size_t> lengths(object_files.size());
 
-    for (auto& [code_file, addr_file, ref_file] : object_files) {
+    for (auto& [code_file, addr_file, ref_file, bank_file] : object_files) {
         lengths.push_back(fsize(code_file));
-        objects.push_back({std::vector<std::uint8_t>(lengths.back()), {}, {}});
+        objects.push_back({std::vector<std::uint8_t>(lengths.back()), {}, {}, {}});
 
         code_file.read(reinterpret_cast<char*>(std::get<0>(objects.back()).data()), lengths.back());
         read_addresses(addr_file, std::get<1>(objects.back()));
         read_references(ref_file, std::get<2>(objects.back()));
+        read_sections(bank_file, std::get<3>(objects.back()));
     }
 
     link(objects, output_bytecode, output_addr, output_ref);
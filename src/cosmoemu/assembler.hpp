@@ -22,6 +22,7 @@
 #include <cstdint>
 
 #include <fstream>
+#include <map>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -127,7 +128,8 @@ typedef enum KEYWORD: std::uint16_t {
     ASM_TYPU8 = BEGIN_ASM + 0x03,
     ASM_TYPI16= BEGIN_ASM + 0x04,
     ASM_TYPU16= BEGIN_ASM + 0x05,
-    END       = ASM_TYPU16 + 1,
+    ASM_BANK  = BEGIN_ASM + 0x06,
+    END       = ASM_BANK + 1,
 }KEYWORD;
 
 typedef enum ARG_TYPE: std::uint8_t {
@@ -161,6 +163,7 @@ void assemble_instruction(
 void assemble_command(
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
+    std::map<std::uint16_t, std::uint16_t>& sections,
     std::vector<std::string>& arguments,
     std::string command,
     KEYWORD token,
@@ -170,7 +173,8 @@ void assemble(
     std::string input,
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
-    std::unordered_map<std::uint16_t, std::string>& references);
+    std::unordered_map<std::uint16_t, std::string>& references,
+    std::map<std::uint16_t, std::uint16_t>& sections);
 
 std::size_t fsize(std::ifstream& file);
 std::size_t fsize(std::fstream& file);
@@ -183,6 +187,14 @@ void write_references(
     const std::unordered_map<std::uint16_t, std::string>& references,
     std::ofstream& ref_file);
 
+void write_references(
+    const std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>>& banked_references,
+    std::ofstream& ref_file);
+
+void write_sections(
+    const std::map<std::uint16_t, std::uint16_t>& sections,
+    std::ofstream& bank_file);
+
 void link_info(
     const std::unordered_map<std::string, std::uint16_t>& addresses,
     const std::unordered_map<std::uint16_t, std::string>& references);
@@ -191,7 +203,8 @@ void assemble(
     std::ifstream& asm_file,
     std::ofstream& code_file,
     std::ofstream& addr_file,
-    std::ofstream& ref_file);
+    std::ofstream& ref_file,
+    std::ofstream& bank_file);
 
 void read_addresses(
     std::ifstream& addr_file,
@@ -201,6 +214,10 @@ void read_references(
     std::ifstream& ref_file,
     std::unordered_map<std::uint16_t, std::string>& references);
 
+void read_sections(
+    std::ifstream& bank_file,
+    std::map<std::uint16_t, std::uint16_t>& sections);
+
 void link(
     std::vector<std::uint8_t>& bytecode,
     std::unordered_map<std::string, std::uint16_t>& addresses,
@@ -210,19 +227,21 @@ void link(
     std::ifstream& code_file,
     std::ifstream& addr_file,
     std::ifstream& ref_file,
+    std::ifstream& bank_file,
     std::ofstream& bin_file);
 
 void link(
     const std::vector<std::tuple<
         std::vector<std::uint8_t>,
         std::unordered_map<std::string, std::uint16_t>,
-        std::unordered_map<std::uint16_t, std::string>>>& objects,
+        std::unordered_map<std::uint16_t, std::string>,
+        std::map<std::uint16_t, std::uint16_t>>>& objects,
     std::vector<std::uint8_t>& output_bytecode,
     std::unordered_map<std::string, std::uint16_t>& output_addr,
-    std::unordered_map<std::uint16_t, std::string>& output_ref);
+    std::map<std::uint16_t, std::unordered_map<std::uint16_t, std::string>>& output_ref);
 
 void link(
-    std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream>>& objects,
+    std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream, std::ifstream>>& objects,
     std::ofstream& output_addr_file,
     std::ofstream& output_ref_file,
     std::ofstream& output_bin_file);
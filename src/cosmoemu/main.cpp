@@ -16,8 +16,6 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#define SDL_MAIN_HANDLED
-
 #include <cstdlib>
 
 #include <chrono>
@@ -25,21 +23,160 @@
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
 
+#include <unistd.h>
+
+#ifdef COSMOVM_SDL
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+#include <cosmovm/ansi_backend.hpp>
+#include <cosmovm/blitter.hpp>
 #include <cosmovm/bus.hpp>
+#include <cosmovm/capture.hpp>
 #include <cosmovm/clock.hpp>
 #include <cosmovm/cpu.hpp>
 #include <cosmovm/disk.hpp>
+#include <cosmovm/disk_image.hpp>
 #include <cosmovm/display.hpp>
-#include <cosmovm/keyboard.hpp>
+#include <cosmovm/headless_backend.hpp>
+#include <cosmovm/hostfs.hpp>
+#include <cosmovm/machine.hpp>
 #include <cosmovm/memory.hpp>
+#include <cosmovm/mmu.hpp>
+#include <cosmovm/overlay_image.hpp>
+#include <cosmovm/sector_cache.hpp>
+#ifdef COSMOVM_SDL
+#include <cosmovm/keyboard.hpp>
+#include <cosmovm/sdl_backend.hpp>
+#endif
 
 #include "assembler.hpp"
 
 constexpr std::size_t TARGET_CPU_FREQ = 1000000; // 1MHz
 constexpr std::size_t TARGET_RENDER_FREQ = 60; // 60Hz
 
+#ifdef COSMOVM_SDL
+typedef cosmovm::machine<cosmovm::cpu, cosmovm::clock, cosmovm::disk, cosmovm::display, cosmovm::keyboard, cosmovm::blitter> cosmo_machine;
+constexpr cosmovm::DISPLAY_BACKENDS DEFAULT_DISPLAY = cosmovm::DISPLAY_BACKENDS::DISPLAY_SDL;
+#else
+// Built without SDL, the keyboard reads SDL scancodes and its ports stay unbound
+typedef cosmovm::machine<cosmovm::cpu, cosmovm::clock, cosmovm::disk, cosmovm::display, cosmovm::blitter> cosmo_machine;
+constexpr cosmovm::DISPLAY_BACKENDS DEFAULT_DISPLAY = cosmovm::DISPLAY_BACKENDS::DISPLAY_HEADLESS;
+#endif
+
+typedef struct run_options
+{
+    std::uint32_t phys_mem_size{cosmovm::MEM_SIZE};
+    cosmovm::DISK_BACKENDS disk_backend{cosmovm::DISK_BACKENDS::STREAM};
+    cosmovm::SYNC_POLICY disk_sync{cosmovm::SYNC_POLICY::SYNC_NONE};
+    bool disk_async{false};
+    std::size_t disk_cache_sectors{0};
+    cosmovm::CACHE_POLICY disk_cache_policy{cosmovm::CACHE_POLICY::FLUSH_ON_PORT};
+    std::string overlay_base{};
+    std::uint32_t overlay_sectors{0};
+    std::vector<std::string> drive_paths{};
+    std::string hostfs_root{};
+    cosmovm::DISPLAY_BACKENDS display_backend{DEFAULT_DISPLAY};
+    std::string dump_frame_path{};
+    std::string font_path{};
+    std::string shm_name{};
+    bool render_thread{false};
+    std::string capture_path{};
+    cosmovm::CAPTURE_FORMATS capture_format{cosmovm::CAPTURE_FORMATS::CAPTURE_Y4M};
+}run_options;
+
+// Removes --name=value options from args, leaving the positional arguments
+run_options parse_options(std::vector<std::string>& args)
+{
+    run_options options;
+
+    auto arg = args.begin() + 1;
+    while (arg != args.end()) {
+        if (arg->rfind("--", 0) != 0) {
+            ++arg;
+            continue;
+        }
+
+        const auto equal_pos = arg->find('=');
+        std::string name = arg->substr(2, equal_pos - 2);
+        std::string value = (equal_pos != std::string::npos) ? arg->substr(equal_pos + 1) : "";
+
+        if (name == "phys-mem") {
+            auto size_kib = cosmoasm::int_literal(value);
+            if (!size_kib.has_value() || size_kib.value() <= 0) {
+                throw std::invalid_argument(std::format("[EMULATOR] Invalid physical memory size {}", value));
+            }
+            options.phys_mem_size = size_kib.value() * 1024;
+        } else if (name == "disk-backend") {
+            if (value == "stream") options.disk_backend = cosmovm::DISK_BACKENDS::STREAM;
+            else if (value == "mmap") options.disk_backend = cosmovm::DISK_BACKENDS::MMAP;
+            else throw std::invalid_argument(std::format("[EMULATOR] Unknown disk backend {}", value));
+        } else if (name == "disk-sync") {
+            if (value == "none") options.disk_sync = cosmovm::SYNC_POLICY::SYNC_NONE;
+            else if (value == "shutdown") options.disk_sync = cosmovm::SYNC_POLICY::SYNC_ON_SHUTDOWN;
+            else if (value == "write") options.disk_sync = cosmovm::SYNC_POLICY::SYNC_ON_WRITE;
+            else throw std::invalid_argument(std::format("[EMULATOR] Unknown disk sync policy {}", value));
+        } else if (name == "disk-async") {
+            options.disk_async = true;
+        } else if (name == "disk-cache") {
+            auto sectors = cosmoasm::int_literal(value);
+            if (!sectors.has_value() || sectors.value() < 0) {
+                throw std::invalid_argument(std::format("[EMULATOR] Invalid cache size {}", value));
+            }
+            options.disk_cache_sectors = sectors.value();
+        } else if (name == "disk-cache-policy") {
+            if (value == "write-through") options.disk_cache_policy = cosmovm::CACHE_POLICY::WRITE_THROUGH;
+            else if (value == "port") options.disk_cache_policy = cosmovm::CACHE_POLICY::FLUSH_ON_PORT;
+            else if (value == "exit") options.disk_cache_policy = cosmovm::CACHE_POLICY::FLUSH_ON_EXIT;
+            else throw std::invalid_argument(std::format("[EMULATOR] Unknown cache policy {}", value));
+        } else if (name == "display") {
+#ifdef COSMOVM_SDL
+            if (value == "sdl") options.display_backend = cosmovm::DISPLAY_BACKENDS::DISPLAY_SDL;
+#else
+            if (value == "sdl") throw std::invalid_argument("[EMULATOR] Built without SDL, use --display=headless or ansi");
+#endif
+            else if (value == "headless") options.display_backend = cosmovm::DISPLAY_BACKENDS::DISPLAY_HEADLESS;
+            else if (value == "ansi") options.display_backend = cosmovm::DISPLAY_BACKENDS::DISPLAY_ANSI;
+            else throw std::invalid_argument(std::format("[EMULATOR] Unknown display backend {}", value));
+        } else if (name == "render-thread") {
+            options.render_thread = true;
+        } else if (name == "capture") {
+            options.capture_path = value;
+        } else if (name == "capture-format") {
+            if (value == "y4m") options.capture_format = cosmovm::CAPTURE_FORMATS::CAPTURE_Y4M;
+            else if (value == "rgb") options.capture_format = cosmovm::CAPTURE_FORMATS::CAPTURE_RGB;
+            else throw std::invalid_argument(std::format("[EMULATOR] Unknown capture format {}", value));
+        } else if (name == "dump-frame") {
+            options.dump_frame_path = value;
+        } else if (name == "font") {
+            options.font_path = value;
+        } else if (name == "shm") {
+            options.shm_name = value;
+        } else if (name == "hostfs") {
+            options.hostfs_root = value;
+        } else if (name == "drive") {
+            options.drive_paths.push_back(value);
+        } else if (name == "create-overlay") {
+            options.overlay_base = value;
+        } else if (name == "overlay-sectors") {
+            auto sectors = cosmoasm::int_literal(value);
+            if (!sectors.has_value() || sectors.value() <= 0) {
+                throw std::invalid_argument(std::format("[EMULATOR] Invalid overlay size {}", value));
+            }
+            options.overlay_sectors = sectors.value();
+        } else {
+            throw std::invalid_argument(std::format("[EMULATOR] Unknown option {}", *arg));
+        }
+        arg = args.erase(arg);
+    }
+    return options;
+}
+
 void build(const std::string& outputpath, const std::string& inputpath)
 {
     {
@@ -48,12 +185,13 @@ void build(const std::string& outputpath, const std::string& inputpath)
         std::ofstream code_file{std::format("{}.code" , outputpath), std::ios::binary | std::ios::out};
         std::ofstream addr_file{std::format("{}.addr", outputpath), std::ios::binary | std::ios::out};
         std::ofstream ref_file {std::format("{}.ref" , outputpath), std::ios::binary | std::ios::out};
+        std::ofstream bank_file{std::format("{}.bank", outputpath), std::ios::binary | std::ios::out};
 
         if (!asm_file.is_open()) {
             throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}", inputpath));
         }
 
-        cosmoasm::assemble(asm_file, code_file, addr_file, ref_file);
+        cosmoasm::assemble(asm_file, code_file, addr_file, ref_file, bank_file);
     }
     {
 
@@ -61,6 +199,7 @@ void build(const std::string& outputpath, const std::string& inputpath)
         std::ifstream code_file{std::format("{}.code" , outputpath), std::ios::binary | std::ios::in};
         std::ifstream addr_file{std::format("{}.addr", outputpath), std::ios::binary | std::ios::in};
         std::ifstream ref_file {std::format("{}.ref" , outputpath), std::ios::binary | std::ios::in};
+        std::ifstream bank_file{std::format("{}.bank", outputpath), std::ios::binary | std::ios::in};
         std::ofstream bin_file {std::format("{}.bin" , outputpath), std::ios::binary | std::ios::out};
 
         if (!code_file.is_open()) {
@@ -72,8 +211,11 @@ void build(const std::string& outputpath, const std::string& inputpath)
         if (!ref_file.is_open()) {
             throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}.ref", outputpath));
         }
+        if (!bank_file.is_open()) {
+            throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}.bank", outputpath));
+        }
 
-        cosmoasm::link(code_file, addr_file, ref_file, bin_file);
+        cosmoasm::link(code_file, addr_file, ref_file, bank_file, bin_file);
     }
 }
 
@@ -89,12 +231,13 @@ void build(const std::string& outputpath, const std::vector<std::string>& inputp
             std::ofstream code_file{std::format("{}.code" , outputpath_prefix), std::ios::binary | std::ios::out};
             std::ofstream addr_file{std::format("{}.addr", outputpath_prefix) , std::ios::binary | std::ios::out};
             std::ofstream ref_file {std::format("{}.ref" , outputpath_prefix) , std::ios::binary | std::ios::out};
+            std::ofstream bank_file{std::format("{}.bank", outputpath_prefix) , std::ios::binary | std::ios::out};
 
             if (!asm_file.is_open()) {
                 throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}", inputpath));
             }
 
-            cosmoasm::assemble(asm_file, code_file, addr_file, ref_file);
+            cosmoasm::assemble(asm_file, code_file, addr_file, ref_file, bank_file);
         }
     }
     {
@@ -103,7 +246,7 @@ void build(const std::string& outputpath, const std::vector<std::string>& inputp
             std::cout << std::format("\t{}", inputpath) << std::endl;
         }
 
-        std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream>> object_files;
+        std::vector<std::tuple<std::ifstream, std::ifstream, std::ifstream, std::ifstream>> object_files;
 
         for (const auto& inputpath : inputpaths) {
             std::string outputpath_prefix = std::filesystem::path(inputpath).filename().string();
@@ -111,7 +254,8 @@ void build(const std::string& outputpath, const std::vector<std::string>& inputp
             object_files.push_back(std::make_tuple(
                 std::ifstream{std::format("{}.code" , outputpath_prefix), std::ios::binary | std::ios::in},
                 std::ifstream{std::format("{}.addr", outputpath_prefix) , std::ios::binary | std::ios::in},
-                std::ifstream{std::format("{}.ref" , outputpath_prefix) , std::ios::binary | std::ios::in}));
+                std::ifstream{std::format("{}.ref" , outputpath_prefix) , std::ios::binary | std::ios::in},
+                std::ifstream{std::format("{}.bank", outputpath_prefix) , std::ios::binary | std::ios::in}));
 
             if (!std::get<0>(object_files.back()).is_open()) {
             throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}.code", outputpath_prefix));
@@ -122,6 +266,9 @@ void build(const std::string& outputpath, const std::vector<std::string>& inputp
             if (!std::get<2>(object_files.back()).is_open()) {
                 throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}.ref", outputpath_prefix));
             }
+            if (!std::get<3>(object_files.back()).is_open()) {
+                throw std::invalid_argument(std::format("[BUILDER] Couldn't open {}.bank", outputpath_prefix));
+            }
         }
 
         std::ofstream addr_file{std::format("{}.addr", outputpath), std::ios::binary | std::ios::out};
@@ -132,78 +279,183 @@ void build(const std::string& outputpath, const std::vector<std::string>& inputp
     }
 }
 
-void run(const std::string& disk_path)
+std::unique_ptr<cosmovm::disk_image> open_drive(const std::string& disk_path, const run_options& options)
 {
-    std::cout << std::format("[EMULATOR] Booting from {}...", disk_path) << std::endl;
+    std::unique_ptr<cosmovm::disk_image> image =
+        cosmovm::open_disk_image(disk_path, options.disk_backend, options.disk_sync);
+    if (options.disk_cache_sectors > 0) {
+        image = std::make_unique<cosmovm::sector_cache>(
+            std::move(image), options.disk_cache_sectors, options.disk_cache_policy);
+    }
+    return image;
+}
 
-    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER);
-    TTF_Init();
+void run(const std::string& disk_path, const run_options& options)
+{
+    std::cout << std::format("[EMULATOR] Booting from {}...", disk_path) << std::endl;
 
-    // Overwrite disk
+#ifdef COSMOVM_SDL
+    // Only the SDL backend brings up SDL video, SDL_ttf is only needed for a TTF font
+    bool headless = (options.display_backend != cosmovm::DISPLAY_BACKENDS::DISPLAY_SDL);
+    bool ttf_font = !headless && !options.font_path.empty();
+    if (!headless) {
+        SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER);
+    }
+    if (ttf_font) {
+        TTF_Init();
+    }
+#endif
+
+    // The terminal is drawn through its own descriptor and everything printed
+    // goes to stderr instead, it can be kept off the screen (ex: 2>cosmovm.log)
+    bool ansi = (options.display_backend == cosmovm::DISPLAY_BACKENDS::DISPLAY_ANSI);
+    int terminal_fd = STDOUT_FILENO;
+    if (ansi) {
+        std::cout.flush();
+        terminal_fd = ::dup(STDOUT_FILENO);
+        ::dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
 
-    // Prepare disk
-    std::vector<std::uint8_t> boot(cosmovm::SECTOR_SIZE, 0);
+    // Called on the render thread when there is one
+    cosmovm::display::backend_factory make_backend = [&options, terminal_fd]() -> std::unique_ptr<cosmovm::display_backend>
     {
-        std::ifstream disk_file{disk_path, std::ios::binary | std::ios::in};
-        if (!disk_file.is_open()) {
-            throw std::invalid_argument(std::format("[EMULATOR] Couldn't open {}", disk_path));
-        }
-        if (cosmoasm::fsize(disk_file) < cosmovm::SECTOR_SIZE) {
-            throw std::invalid_argument(std::format("[EMULATOR] Invalid boot disk {}", disk_path));
+        switch (options.display_backend)
+        {
+#ifdef COSMOVM_SDL
+            case cosmovm::DISPLAY_BACKENDS::DISPLAY_SDL:
+                return std::make_unique<cosmovm::sdl_backend>("CosmoVM", options.font_path);
+#endif
+            case cosmovm::DISPLAY_BACKENDS::DISPLAY_ANSI:
+                return std::make_unique<cosmovm::ansi_backend>(terminal_fd);
+            default:
+                return std::make_unique<cosmovm::headless_backend>(options.dump_frame_path);
         }
-        disk_file.read(reinterpret_cast<char*>(boot.data()), cosmovm::SECTOR_SIZE);
+    };
+
+    // Prepare disks, the boot disk is drive 0
+    std::vector<std::unique_ptr<cosmovm::disk_image>> images;
+    images.push_back(open_drive(disk_path, options));
+    for (const auto& drive_path : options.drive_paths) {
+        std::cout << std::format("[EMULATOR] Drive {}: {}", images.size(), drive_path) << std::endl;
+        images.push_back(open_drive(drive_path, options));
+    }
+    std::vector<std::uint8_t> boot(cosmovm::SECTOR_SIZE, 0);
+    if (images.front()->get_sectors_count() < 1) {
+        throw std::invalid_argument(std::format("[EMULATOR] Invalid boot disk {}", disk_path));
     }
+    images.front()->read(0, boot.data());
 
     // Initialize emulator components
-    std::shared_ptr<cosmovm::memory> cmem = std::make_shared<cosmovm::memory>(0, boot, cosmovm::SECTOR_SIZE);
-    std::shared_ptr<cosmovm::bus> cbus = std::make_shared<cosmovm::bus>(cmem);
-    std::unique_ptr<cosmovm::clock> cclk = std::make_unique<cosmovm::clock>(cbus);
-    std::unique_ptr<cosmovm::cpu> ccpu = std::make_unique<cosmovm::cpu>(cbus);
-    std::unique_ptr<cosmovm::disk> cdsk = std::make_unique<cosmovm::disk>(cbus, disk_path);
-    std::unique_ptr<cosmovm::display> cscr = std::make_unique<cosmovm::display>(cbus, "CosmoVM");
-    std::unique_ptr<cosmovm::keyboard> ckb = std::make_unique<cosmovm::keyboard>(cbus);
+    std::shared_ptr<cosmovm::memory> cmem =
+        std::make_shared<cosmovm::memory>(options.phys_mem_size, 0, boot, cosmovm::SECTOR_SIZE);
+    std::unique_ptr<cosmo_machine> vm = std::make_unique<cosmo_machine>(cmem,
+        std::make_tuple(), std::make_tuple(std::move(images), options.disk_async), std::make_tuple(make_backend, options.render_thread),
+#ifdef COSMOVM_SDL
+        std::make_tuple(),
+#endif
+        std::make_tuple());
+    // Bank switching only makes sense with more than 64 KiB of physical memory
+    std::unique_ptr<cosmovm::mmu> cmmu;
+    if (options.phys_mem_size > cosmovm::MEM_SIZE) {
+        std::cout << std::format("[EMULATOR] {} KiB of physical memory in {} banks",
+            options.phys_mem_size / 1024, cmem->get_bank_count()) << std::endl;
+        cmmu = std::make_unique<cosmovm::mmu>(vm->get_bus());
+    }
+    std::unique_ptr<cosmovm::hostfs> chfs;
+    if (!options.hostfs_root.empty()) {
+        std::cout << std::format("[EMULATOR] Sharing {} with the guest", options.hostfs_root) << std::endl;
+        chfs = std::make_unique<cosmovm::hostfs>(vm->get_bus(), options.hostfs_root);
+    }
+    cosmovm::cpu& ccpu = vm->get_cpu();
+    cosmovm::display& cscr = vm->get<cosmovm::display>();
+    if (!options.capture_path.empty()) {
+        std::cout << std::format("[EMULATOR] Capturing the screen into {}", options.capture_path) << std::endl;
+        cscr.attach_capture(std::make_unique<cosmovm::frame_capture>(options.capture_path, options.capture_format));
+    }
+    if (!options.shm_name.empty()) {
+        auto shm = std::make_unique<cosmovm::shm_framebuffer>(options.shm_name);
+        std::cout << std::format("[EMULATOR] Publishing the screen in shared memory {}", shm->get_name()) << std::endl;
+        cscr.attach_shm(std::move(shm));
+    }
 
     // Run
     std::size_t cycles_to_execute = TARGET_CPU_FREQ / TARGET_RENDER_FREQ;
     double sleep_time = 0;
+    double total_render_time = 0;
+    std::size_t frames = 0;
 
-    while (cscr->window_is_open() && !ccpu->shutdown_flag_set())
+    while (cscr.window_is_open() && !ccpu.shutdown_flag_set())
     {
         // RUNNING
         // Execute instructions
         auto start_cpu_time = std::chrono::high_resolution_clock::now();
-        for (std::size_t i = 0; i < std::max(cycles_to_execute, static_cast<std::size_t>(1)); i++) ccpu->run();
+        // A guest waiting for vsync (port 0x45) gives up the rest of the frame
+        for (std::size_t i = 0; i < std::max(cycles_to_execute, static_cast<std::size_t>(1)); i++) {
+            ccpu.run();
+            if (cscr.waiting_vsync()) break;
+        }
         auto end_cpu_time = std::chrono::high_resolution_clock::now();
 
         // Render
         auto start_render_time = std::chrono::high_resolution_clock::now();
-        cscr->run();
+        cscr.run();
         auto end_render_time = std::chrono::high_resolution_clock::now();
 
         // TIMING
         auto cpu_time = std::chrono::duration_cast<std::chrono::duration<double>>(end_cpu_time - start_cpu_time).count();
         auto render_time = std::chrono::duration_cast<std::chrono::duration<double>>(end_render_time - start_render_time).count();
+        total_render_time += render_time;
+        frames++;
 
         if ((1.F / TARGET_RENDER_FREQ) >= (cpu_time + render_time))
             sleep_time = (1.F / TARGET_RENDER_FREQ) - (cpu_time + render_time);
         else sleep_time = 0;
 
-        // Seconds -> Milliseconds
-        SDL_Delay(sleep_time * 1000);
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleep_time));
     }
 
     std::cout << "[EMULATOR] Shutting down..." << std::endl;
+    if (frames > 0) {
+        std::cout << std::format("[EMULATOR] Average render time {:.3f} ms over {} frames",
+            total_render_time * 1000 / frames, frames) << std::endl;
+    }
 
-    if (ccpu->shutdown_flag_set() && ccpu->exception_flag_set()) {
+    if (ccpu.shutdown_flag_set() && ccpu.exception_flag_set()) {
         std::cout << std::format("[EMULATOR] Exception flag set, dumping memory into {}...", cosmovm::DUMP_PATH) << std::endl;
         cmem->dump();
     }
 
     // Destroy SDL objects first then clean
-    cscr.reset();
+    chfs.reset();
+    cmmu.reset();
+    vm.reset();
+
+    if (ansi) {
+        std::cout.flush();
+        ::dup2(terminal_fd, STDOUT_FILENO);
+        ::close(terminal_fd);
+    }
+
+#ifdef COSMOVM_SDL
+    if (ttf_font) {
+        TTF_Quit();
+    }
+    if (!headless) {
+        SDL_Quit();
+    }
+#endif
+}
 
-    TTF_Quit();
-    SDL_Quit();
+void create_overlay(const std::string& overlay_path, const run_options& options)
+{
+    std::uint32_t sectors_count = options.overlay_sectors;
+    if (sectors_count == 0) {
+        sectors_count = cosmovm::open_disk_image(options.overlay_base, cosmovm::DISK_BACKENDS::STREAM,
+            cosmovm::SYNC_POLICY::SYNC_NONE, true)->get_sectors_count();
+    }
+    std::cout << std::format("[EMULATOR] Creating overlay {} of {} sectors over {}...",
+        overlay_path, sectors_count, options.overlay_base) << std::endl;
+    cosmovm::overlay_image::create(overlay_path, options.overlay_base, sectors_count);
 }
 
 int main(int argc, char** argv)
@@ -211,20 +463,43 @@ int main(int argc, char** argv)
     std::vector<std::string> args(argv, argv + argc);
 
     try {
-        if (argc == 1) {
+        run_options options = parse_options(args);
+
+        if (args.size() == 1) {
             std::cout <<
                 "CosmoVM an emulator and assembler for an imaginary cpu\n"
                 "Licensed under GPL-3.0, (see https://www.gnu.org/licenses/)"
                 << std::endl;
-            std::cout << std::format("\tUsage: {} [DISK_PATH]", args.at(0)) << std::endl;
+            std::cout << std::format("\tUsage: {} [OPTIONS] [DISK_PATH]", args.at(0)) << std::endl;
             std::cout << std::format("\tUsage: {} [OUTPUT_PREFIX] [INPUT_ASM]", args.at(0)) << std::endl;
             std::cout << std::format("\tUsage: {} [OUTPUT_PREFIX] [INPUT_ASM1] [INPUT_ASM2]...", args.at(0)) << std::endl;
-        } else if(argc == 2) {
-            run(args.at(1));
-        } else if (argc == 3) {
+            std::cout << "Options:" << std::endl;
+            std::cout << "\t--phys-mem=SIZE_KIB: Physical memory size, enables bank switching above 64" << std::endl;
+            std::cout << "\t--disk-backend=stream|mmap: Disk image access, mmap copies sectors from a mapping" << std::endl;
+            std::cout << "\t--disk-sync=none|shutdown|write: When disk writes are flushed to the host" << std::endl;
+            std::cout << "\t--disk-async: Run disk requests on a worker thread, poll port 0x67 for completion" << std::endl;
+            std::cout << "\t--disk-cache=SECTORS: Keep recently used sectors in an LRU cache" << std::endl;
+            std::cout << "\t--disk-cache-policy=write-through|port|exit: When cached writes reach the image, port 0x6B by default" << std::endl;
+            std::cout << "\t--display=sdl|headless|ansi: Draw into a window, an in-memory framebuffer or the terminal (text mode only), sdl by default when built with it" << std::endl;
+            std::cout << "\t\tWith ansi the emulator messages go to stderr, redirect it to keep them off the screen" << std::endl;
+            std::cout << "\t--render-thread: Draw frames on their own thread while the cpu runs the next one" << std::endl;
+            std::cout << "\t--capture=PATH: Record the frames where the screen changed into a file or a named pipe" << std::endl;
+            std::cout << "\t--capture-format=y4m|rgb: YUV4MPEG2 with timestamped frames, or raw RGB24 with timestamps in PATH.pts" << std::endl;
+            std::cout << "\t--dump-frame=PATH: Headless only, write the last frame as a PPM image on exit" << std::endl;
+            std::cout << "\t--shm=NAME: Publish every frame in the POSIX shared memory segment /NAME for external viewers, it must not exist yet" << std::endl;
+            std::cout << "\t--font=PATH: Draw the SDL window text with a TTF font (ex: vgafont.ttf) instead of the built-in one" << std::endl;
+            std::cout << "\t--hostfs=DIR: Let the guest open files under DIR through ports 0x81-0x87" << std::endl;
+            std::cout << "\t--drive=PATH: Attach another disk image, repeatable, drives are numbered from 1" << std::endl;
+            std::cout << "\t--create-overlay=BASE_PATH: Create DISK_PATH as a copy-on-write overlay of BASE_PATH" << std::endl;
+            std::cout << "\t--overlay-sectors=COUNT: Overlay size, the base size by default" << std::endl;
+        } else if(args.size() == 2 && !options.overlay_base.empty()) {
+            create_overlay(args.at(1), options);
+        } else if(args.size() == 2) {
+            run(args.at(1), options);
+        } else if (args.size() == 3) {
             build(args.at(1), args.at(2));
         } else {
-            build(args.at(1), std::vector<std::string>(argv + 2, argv + argc));
+            build(args.at(1), std::vector<std::string>(args.begin() + 2, args.end()));
         }
     } catch (const std::exception& err) {
         std::cerr << err.what() << std::endl;
@@ -11,7 +11,14 @@ target("cosmoemu")
     add_includedirs(ROOT_DIR .. "include")
     add_deps("cosmocore_static", "cosmocore_shared")
     add_linkdirs(ROOT_DIR .. "build")
-    add_links("SDL2", "SDL2_ttf", "cosmovm")
+    add_links("cosmovm")
+    add_options("sdl")
+    if has_config("sdl") then
+        add_links("SDL2", "SDL2_ttf")
+    end
+    if is_plat("linux") then
+        add_syslinks("pthread", "rt")
+    end
     local local_ROOT_DIR = ROOT_DIR
     after_build(function (target)
         os.cp(target:targetfile(), local_ROOT_DIR .. "build")
@@ -0,0 +1,196 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <iterator>
+
+#include <unistd.h>
+
+#include <cosmovm/ansi_backend.hpp>
+
+using namespace cosmovm;
+
+// No palette color has a zero alpha, the terminal colors are unknown
+constexpr u32 UNKNOWN_COLOR = 0;
+
+// Set from the signal handler, read by poll_events
+static volatile std::sig_atomic_t close_requested = 0;
+
+static void request_close(int)
+{
+    close_requested = 1;
+}
+
+ansi_backend::ansi_backend(int fd)
+:
+m_fd(fd),
+m_text_shadow(),
+m_drawn_mode(VIDEO_MODES::TEXT),
+m_redraw(true),
+m_out(),
+m_cursor(-1),
+m_foreground(UNKNOWN_COLOR),
+m_background(UNKNOWN_COLOR),
+m_frames(0),
+m_old_sigint(),
+m_old_sigterm()
+{
+    // A second signal kills the emulator, in case it doesn't get to poll_events
+    struct sigaction action{};
+    action.sa_handler = request_close;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    close_requested = 0;
+    ::sigaction(SIGINT, &action, &m_old_sigint);
+    ::sigaction(SIGTERM, &action, &m_old_sigterm);
+
+    // A full screen of cells with their colors fits without growing
+    m_out.reserve(TEXT_MODE_W * TEXT_MODE_H * 48);
+    m_out += "\x1b[0m\x1b[2J\x1b[?25l";
+    flush();
+}
+
+ansi_backend::~ansi_backend()
+{
+    std::format_to(std::back_inserter(m_out), "\x1b[0m\x1b[?25h\x1b[{};1H\n", TEXT_MODE_H);
+    flush();
+    ::sigaction(SIGINT, &m_old_sigint, nullptr);
+    ::sigaction(SIGTERM, &m_old_sigterm, nullptr);
+}
+
+bool ansi_backend::poll_events()
+{
+    // Ctrl-C closes the display like an SDL window, the terminal is given back on the way out
+    return close_requested == 0;
+}
+
+void ansi_backend::render_text(const text_screen& screen)
+{
+    if (m_drawn_mode != VIDEO_MODES::TEXT) {
+        m_out += "\x1b[0m\x1b[2J";
+        m_cursor = -1;
+        m_foreground = UNKNOWN_COLOR;
+        m_background = UNKNOWN_COLOR;
+        m_drawn_mode = VIDEO_MODES::TEXT;
+        m_redraw = true;
+    }
+
+    for (u16 cell = 0; cell < TEXT_MODE_W * TEXT_MODE_H; cell++)
+    {
+        // The cursor is the terminal one, moving it leaves the cells as they are
+        u32 foreground = screen.foreground(cell);
+        u32 background = screen.background(cell);
+        if (!m_redraw
+            && screen.glyphs[cell] == m_text_shadow.glyphs[cell]
+            && foreground == m_text_shadow.foreground(cell)
+            && background == m_text_shadow.background(cell))
+            continue;
+        move_to(cell);
+        set_colors(foreground, background);
+        put_glyph(screen.glyphs[cell]);
+        // Past the last column the terminal waits to wrap, better not rely on it
+        m_cursor = (cell % TEXT_MODE_W == TEXT_MODE_W - 1) ? -1 : cell + 1;
+    }
+
+    // The guest cursor is the terminal one
+    bool visible = (screen.cursor != TEXT_CURSOR_HIDDEN);
+    if (m_redraw || visible != (m_text_shadow.cursor != TEXT_CURSOR_HIDDEN))
+        m_out += visible ? "\x1b[?25h" : "\x1b[?25l";
+    if (visible)
+        move_to(screen.cursor);
+
+    m_text_shadow = screen;
+    m_redraw = false;
+    m_frames++;
+    flush();
+}
+
+void ansi_backend::render_graphic(const u8*, const gfx_rows&)
+{
+    if (m_drawn_mode == VIDEO_MODES::TEXT) {
+        m_out += "\x1b[0m\x1b[2J\x1b[H\x1b[?25l[DISPLAY] The graphic modes are not drawn on a terminal";
+        m_cursor = -1;
+        m_foreground = UNKNOWN_COLOR;
+        m_background = UNKNOWN_COLOR;
+        m_drawn_mode = VIDEO_MODES::GRAPHIC;
+        flush();
+    }
+    m_frames++;
+}
+
+usz ansi_backend::get_frames_count() const
+{
+    return m_frames;
+}
+
+void ansi_backend::move_to(u16 cell)
+{
+    if (m_cursor == cell)
+        return;
+    std::format_to(std::back_inserter(m_out), "\x1b[{};{}H", cell / TEXT_MODE_W + 1, cell % TEXT_MODE_W + 1);
+    m_cursor = cell;
+}
+
+void ansi_backend::set_colors(u32 foreground, u32 background)
+{
+    // 24-bit colors, the RGBA palettes are shown as the other backends draw them
+    if (foreground != m_foreground) {
+        std::format_to(std::back_inserter(m_out), "\x1b[38;2;{};{};{}m",
+            foreground >> 24, (foreground >> 16) & 0xFF, (foreground >> 8) & 0xFF);
+        m_foreground = foreground;
+    }
+    if (background != m_background) {
+        std::format_to(std::back_inserter(m_out), "\x1b[48;2;{};{};{}m",
+            background >> 24, (background >> 16) & 0xFF, (background >> 8) & 0xFF);
+        m_background = background;
+    }
+}
+
+void ansi_backend::put_glyph(u8 glyph)
+{
+    // Glyphs are Latin-1 like the font, sent as UTF-8. NUL is blank and
+    // control codes, which the font has no glyph for, show as '?'
+    if (glyph == 0) {
+        m_out += ' ';
+    } else if (glyph >= 0x20 && glyph < 0x7F) {
+        m_out += static_cast<char>(glyph);
+    } else if (glyph >= 0xA0) {
+        m_out += static_cast<char>(0xC0 | (glyph >> 6));
+        m_out += static_cast<char>(0x80 | (glyph & 0x3F));
+    } else {
+        m_out += '?';
+    }
+}
+
+void ansi_backend::flush()
+{
+    // One write per frame unless the terminal takes it in pieces,
+    // a closed terminal drops the frame
+    usz written = 0;
+    while (written < m_out.size())
+    {
+        ssize_t count = ::write(m_fd, m_out.data() + written, m_out.size() - written);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        written += count;
+    }
+    m_out.clear();
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <cosmovm/blitter.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace cosmovm;
+
+// dst keeps its pixel wherever src equals key
+static void blend_keyed(const u8* src, u8* dst, u16 width, u8 key)
+{
+    u16 x = 0;
+#ifdef __SSE2__
+    const __m128i keys = _mm_set1_epi8(static_cast<char>(key));
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+        __m128i transparent = _mm_cmpeq_epi8(s, keys);
+        __m128i out = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), out);
+    }
+#endif
+    for (; x < width; x++)
+        if (src[x] != key)
+            dst[x] = src[x];
+}
+
+blitter::blitter(std::shared_ptr<bus>& bus)
+:
+m_bus(bus),
+m_src(0),
+m_dst(0),
+m_width(0),
+m_height(0),
+m_src_stride(0),
+m_dst_stride(0),
+m_fill(0),
+m_key(BLIT_NO_KEY),
+m_status(BLIT_STATUS::BLIT_READY),
+m_src_row(),
+m_dst_row()
+{
+    m_bus->bind_device(this);
+}
+
+blitter::~blitter()
+{
+}
+
+void blitter::set_src(u16 addr)
+{
+    m_src = addr;
+}
+
+void blitter::set_dst(u16 addr)
+{
+    m_dst = addr;
+}
+
+void blitter::set_width(u16 width)
+{
+    m_width = width;
+}
+
+void blitter::set_height(u16 height)
+{
+    m_height = height;
+}
+
+void blitter::set_src_stride(u16 stride)
+{
+    m_src_stride = stride;
+}
+
+void blitter::set_dst_stride(u16 stride)
+{
+    m_dst_stride = stride;
+}
+
+void blitter::set_fill(u16 color)
+{
+    m_fill = color;
+}
+
+void blitter::set_key(u16 key)
+{
+    m_key = key;
+}
+
+void blitter::run_command(u16 command)
+{
+    if (!fits(m_dst, row_stride(m_dst_stride), m_width, m_height)) {
+        m_status = BLIT_STATUS::BLIT_FAULT;
+        return;
+    }
+
+    switch (command)
+    {
+        case BLIT_COMMANDS::BLIT_FILL:
+            fill();
+            break;
+        case BLIT_COMMANDS::BLIT_COPY:
+        case BLIT_COMMANDS::BLIT_MASKED:
+            if (!fits(m_src, row_stride(m_src_stride), m_width, m_height)) {
+                m_status = BLIT_STATUS::BLIT_FAULT;
+                return;
+            }
+            copy(command == BLIT_COMMANDS::BLIT_MASKED && m_key < BLIT_NO_KEY);
+            break;
+        default:
+            m_status = BLIT_STATUS::BLIT_FAULT;
+            return;
+    }
+    m_status = BLIT_STATUS::BLIT_READY;
+}
+
+u16 blitter::get_status()
+{
+    return m_status;
+}
+
+u16 blitter::row_stride(u16 stride) const
+{
+    return stride ? stride : m_width;
+}
+
+bool blitter::fits(u16 addr, u16 stride, u16 width, u16 height)
+{
+    if (width == 0 || height == 0)
+        return true;
+    return addr + static_cast<u32>(height - 1) * stride + width <= MEM_SIZE;
+}
+
+void blitter::fill()
+{
+    u16 dst_stride = row_stride(m_dst_stride);
+    m_dst_row.assign(m_width, m_fill);
+    for (u16 row = 0; row < m_height; row++)
+        m_bus->get_memory()->write_block(m_dst + row * dst_stride, m_dst_row.data(), m_width);
+}
+
+void blitter::copy(bool masked)
+{
+    u16 src_stride = row_stride(m_src_stride);
+    u16 dst_stride = row_stride(m_dst_stride);
+    const std::shared_ptr<memory>& mem = m_bus->get_memory();
+
+    // Rows are read whole before being written, going up when the
+    // destination is after the source keeps overlapping rectangles intact.
+    // With different strides rows cross, the whole source is read first
+    u32 src_end = m_src + static_cast<u32>(m_height - 1) * src_stride + m_width;
+    u32 dst_end = m_dst + static_cast<u32>(m_height - 1) * dst_stride + m_width;
+    bool staged = src_stride != dst_stride && m_src < dst_end && m_dst < src_end;
+    m_src_row.resize(staged ? static_cast<usz>(m_width) * m_height : m_width);
+    m_dst_row.resize(m_width);
+    if (staged) {
+        for (u16 row = 0; row < m_height; row++)
+            mem->read_block(m_src + row * src_stride, m_src_row.data() + static_cast<usz>(row) * m_width, m_width);
+    }
+
+    bool upward = m_dst > m_src;
+    for (u16 i = 0; i < m_height; i++)
+    {
+        u16 row = upward ? m_height - 1 - i : i;
+        u16 dst = m_dst + row * dst_stride;
+        const u8* src_row = m_src_row.data();
+        if (staged)
+            src_row += static_cast<usz>(row) * m_width;
+        else
+            mem->read_block(m_src + row * src_stride, m_src_row.data(), m_width);
+        if (!masked) {
+            mem->write_block(dst, src_row, m_width);
+            continue;
+        }
+        mem->read_block(dst, m_dst_row.data(), m_width);
+        blend_keyed(src_row, m_dst_row.data(), m_width, m_key);
+        mem->write_block(dst, m_dst_row.data(), m_width);
+    }
+}
\ No newline at end of file
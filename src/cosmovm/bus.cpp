@@ -23,31 +23,44 @@ using namespace cosmovm;
 bus::bus(std::shared_ptr<memory>& memory_ref)
 :
 m_memory(memory_ref),
-m_port()
+m_port_in(PORT_COUNT, {&bus::unbound_in, this}),
+m_port_out(PORT_COUNT, {&bus::unbound_out, this}),
+m_fault_handler(&bus::ignore_fault),
+m_fault_ctx(nullptr)
 {
 }
 
-void bus::bind_port(u16 port, const std::function<u16(u16)>& func_ptr)
+void bus::bind_port(u16 port, port_in_handler in, port_out_handler out, void* ctx)
 {
-    if (m_port.find(port) != m_port.end())
+    if (m_port_in[port].handler != &bus::unbound_in || m_port_out[port].handler != &bus::unbound_out)
         throw std::invalid_argument(std::format("[BUS] Port {} already exists", port));
-    m_port[port] = func_ptr;
+    if (in != nullptr)
+        m_port_in[port] = {in, ctx};
+    if (out != nullptr)
+        m_port_out[port] = {out, ctx};
+}
+
+void bus::set_fault_handler(port_fault_handler handler, void* ctx)
+{
+    m_fault_handler = handler;
+    m_fault_ctx = ctx;
+}
+
+void bus::fault(u16 port)
+{
+    m_fault_handler(m_fault_ctx, port);
 }
 
 u16 bus::device_in(u16 port)
 {
-    if (m_port.find(port) == m_port.end())
-        throw std::invalid_argument(std::format("[BUS] Port {} isn't bound", port));
-    // Dummy value
-    return m_port.at(port)(PORT_DUMMY_VALUE);
+    const port_in_entry& entry = m_port_in[port];
+    return entry.handler(entry.ctx, port);
 }
 
 void bus::device_out(u16 port, u16 data)
 {
-    if (m_port.find(port) == m_port.end())
-        throw std::invalid_argument(std::format("[BUS] Port {} isn't bound", port));
-    // Return value discarded
-     m_port.at(port)(data);
+    const port_out_entry& entry = m_port_out[port];
+    entry.handler(entry.ctx, port, data);
 }
 
 u8 bus::mem_read8(u16 addr)
@@ -73,4 +86,31 @@ void bus::mem_write16(u16 addr, u16 data)
 const std::shared_ptr<memory>& bus::get_memory() const
 {
     return m_memory;
+}
+
+u16 bus::dispatch_in(void* ctx, u16 port)
+{
+    return static_cast<bus*>(ctx)->device_in(port);
+}
+
+void bus::dispatch_out(void* ctx, u16 port, u16 data)
+{
+    static_cast<bus*>(ctx)->device_out(port, data);
+}
+
+u16 bus::unbound_in(void* ctx, u16 port)
+{
+    bus* self = static_cast<bus*>(ctx);
+    self->m_fault_handler(self->m_fault_ctx, port);
+    return 0;
+}
+
+void bus::unbound_out(void* ctx, u16 port, u16)
+{
+    bus* self = static_cast<bus*>(ctx);
+    self->m_fault_handler(self->m_fault_ctx, port);
+}
+
+void bus::ignore_fault(void*, u16)
+{
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <cosmovm/capture.hpp>
+
+using namespace cosmovm;
+
+// BT.601 full range, 8 bits of fraction
+static u8 luma(u32 r, u32 g, u32 b)
+{
+    return (77 * r + 150 * g + 29 * b + 128) >> 8;
+}
+
+static u8 chroma_blue(int r, int g, int b)
+{
+    return std::clamp((-43 * r - 85 * g + 128 * b + 128) / 256 + 128, 0, 255);
+}
+
+static u8 chroma_red(int r, int g, int b)
+{
+    return std::clamp((128 * r - 107 * g - 21 * b + 128) / 256 + 128, 0, 255);
+}
+
+frame_capture::frame_capture(const std::string& path, CAPTURE_FORMATS format)
+:
+m_format(format),
+m_file(path, std::ios::binary | std::ios::out | std::ios::trunc),
+m_pts_file(),
+m_screen(),
+m_encoded(),
+m_text_screen(),
+m_tile_pixels(),
+m_start(std::chrono::steady_clock::now()),
+m_mutex(),
+m_queue_cv(),
+m_queue(),
+m_free(),
+m_quit(false),
+m_written(0),
+m_dropped(0),
+m_writer()
+{
+    if (!m_file.is_open())
+        throw std::invalid_argument(std::format("[CAPTURE] Couldn't open {}", path));
+
+    switch (m_format)
+    {
+        case CAPTURE_FORMATS::CAPTURE_Y4M:
+            // Only changed frames are written, the rate is the display's nominal one
+            m_file << std::format("YUV4MPEG2 W{} H{} F60:1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n", WINDOW_W, WINDOW_H);
+            m_encoded.resize(WINDOW_W * WINDOW_H * 3 / 2);
+            break;
+        case CAPTURE_FORMATS::CAPTURE_RGB:
+            m_pts_file.open(path + ".pts", std::ios::out | std::ios::trunc);
+            m_encoded.resize(WINDOW_W * WINDOW_H * 3);
+            break;
+        default:
+            throw std::invalid_argument(std::format("[CAPTURE] Unknown format {}", static_cast<int>(format)));
+    }
+
+    m_writer = std::thread(&frame_capture::writer_loop, this);
+}
+
+frame_capture::~frame_capture()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_queue_cv.notify_one();
+    m_writer.join();
+    std::cout << std::format("[CAPTURE] {} frames written, {} dropped", m_written, m_dropped) << std::endl;
+}
+
+void frame_capture::push(VIDEO_MODES mode, const text_registers& text, const u8* vram)
+{
+    std::unique_ptr<capture_frame> frame;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= CAPTURE_QUEUE_DEPTH) {
+            m_dropped++;
+            return;
+        }
+        if (!m_free.empty()) {
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+    if (frame == nullptr)
+        frame = std::make_unique<capture_frame>();
+
+    // Copied outside the lock, the writer never waits on the emulation thread
+    frame->mode = mode;
+    frame->text = text;
+    std::copy_n(vram, VIDEO_MEM_SIZE, frame->vram.begin());
+    frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+    }
+    m_queue_cv.notify_one();
+}
+
+void frame_capture::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_queue_cv.wait(lock, [this]()
+        {
+            return m_quit || !m_queue.empty();
+        });
+        if (m_queue.empty())
+            break;
+
+        std::unique_ptr<capture_frame> frame = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        encode(*frame);
+        lock.lock();
+        m_free.push_back(std::move(frame));
+        m_written++;
+    }
+}
+
+void frame_capture::encode(const capture_frame& frame)
+{
+    // Every frame is drawn whole, the screen only keeps what the last mode drew
+    gfx_rows all_rows;
+    all_rows.fill(true);
+    if (frame.mode == VIDEO_MODES::GRAPHIC) {
+        m_screen.render_graphic(frame.vram.data(), all_rows);
+    } else if (frame.mode == VIDEO_MODES::TILE) {
+        compose_tiles(frame.vram.data(), m_tile_pixels.data());
+        m_screen.render_graphic(m_tile_pixels.data(), all_rows);
+    } else {
+        resolve_text_screen(frame.vram.data(), frame.text, m_text_screen);
+        m_screen.render_text(m_text_screen);
+    }
+    const std::vector<u32>& pixels = m_screen.get_framebuffer();
+
+    if (m_format == CAPTURE_FORMATS::CAPTURE_RGB) {
+        for (usz i = 0; i < pixels.size(); i++)
+        {
+            m_encoded[i * 3] = pixels[i] >> 24;
+            m_encoded[i * 3 + 1] = pixels[i] >> 16;
+            m_encoded[i * 3 + 2] = pixels[i] >> 8;
+        }
+        m_file.write(reinterpret_cast<const char*>(m_encoded.data()), m_encoded.size());
+        m_pts_file << frame.timestamp.count() << '\n';
+        return;
+    }
+
+    // Full resolution luma, chroma averaged over 2x2 blocks
+    u8* y_plane = m_encoded.data();
+    u8* cb_plane = y_plane + WINDOW_W * WINDOW_H;
+    u8* cr_plane = cb_plane + (WINDOW_W / 2) * (WINDOW_H / 2);
+    for (usz i = 0; i < pixels.size(); i++)
+        y_plane[i] = luma(pixels[i] >> 24, (pixels[i] >> 16) & 0xFF, (pixels[i] >> 8) & 0xFF);
+    for (u16 y = 0; y < WINDOW_H / 2; y++)
+    {
+        for (u16 x = 0; x < WINDOW_W / 2; x++)
+        {
+            int r = 0, g = 0, b = 0;
+            for (u16 i = 0; i < 4; i++)
+            {
+                u32 pixel = pixels[(y * 2 + i / 2) * WINDOW_W + x * 2 + i % 2];
+                r += pixel >> 24;
+                g += (pixel >> 16) & 0xFF;
+                b += (pixel >> 8) & 0xFF;
+            }
+            cb_plane[y * (WINDOW_W / 2) + x] = chroma_blue(r / 4, g / 4, b / 4);
+            cr_plane[y * (WINDOW_W / 2) + x] = chroma_red(r / 4, g / 4, b / 4);
+        }
+    }
+    m_file << std::format("FRAME XUS={}\n", frame.timestamp.count());
+    m_file.write(reinterpret_cast<const char*>(m_encoded.data()), m_encoded.size());
+}
\ No newline at end of file
@@ -25,7 +25,7 @@
 using namespace cosmovm;
 
 cpu::cpu(std::shared_ptr<bus>& bus)
-: m_regs(), m_bus(bus)
+: m_regs(), m_bus(bus), m_io_in(&bus::dispatch_in), m_io_out(&bus::dispatch_out), m_io_ctx(m_bus.get()), m_faulted_ports(PORT_COUNT, false)
 {
     m_regs.regs.xa = START_ADDR;
     // ALL INSTRUCTION START
@@ -362,11 +362,11 @@ cpu::cpu(std::shared_ptr<bus>& bus)
 
         {IN, [this](u32 instruction) -> void
         {
-            m_regs.table[(instruction >> 8) & 0xFF] = m_bus->device_in((instruction >> 16) & 0xFFFF);
+            m_regs.table[(instruction >> 8) & 0xFF] = m_io_in(m_io_ctx, (instruction >> 16) & 0xFFFF);
         }},
         {OUT, [this](u32 instruction) -> void
         {
-            m_bus->device_out((instruction >> 16) & 0xFFFF, m_regs.table[(instruction >> 8) & 0xFF]);
+            m_io_out(m_io_ctx, (instruction >> 16) & 0xFFFF, m_regs.table[(instruction >> 8) & 0xFF]);
         }},
 
         {CLER, [this](u32) -> void
@@ -395,6 +395,8 @@ cpu::cpu(std::shared_ptr<bus>& bus)
         }},
     };
     // ALL INSTRUCTION END
+
+    m_bus->set_fault_handler(&cpu::port_fault, this);
 }
 
 cpu::~cpu() {}
@@ -434,6 +436,13 @@ void cpu::run()
         reboot();
 }
 
+void cpu::attach_io(port_in_handler io_in, port_out_handler io_out, void* ctx)
+{
+    m_io_in = io_in;
+    m_io_out = io_out;
+    m_io_ctx = ctx;
+}
+
 bool cpu::shutdown_flag_set()
 {
     return (m_flags & FLAGS::SHUTDOWN);
@@ -496,4 +505,14 @@ void cpu::set_cmp_flags(u16 operand1, u16 operand2)
     if (operand1 > operand2)
         m_flags |= FLAGS::GREATER;
     else m_flags &= ~FLAGS::GREATER;
+}
+
+void cpu::port_fault(void* ctx, u16 port)
+{
+    cpu* self = static_cast<cpu*>(ctx);
+    self->m_flags |= FLAGS::ERROR;
+    if (!self->m_faulted_ports[port]) {
+        self->m_faulted_ports[port] = true;
+        std::clog << std::format("[CPU] Fault on port 0x{:02X}, later ones are silent", port) << std::endl;
+    }
 }
\ No newline at end of file
@@ -21,41 +21,73 @@
 using namespace cosmovm;
 
 disk::disk(std::shared_ptr<bus>& bus, const std::string& disk_path)
+: disk(bus, open_disk_image(disk_path))
+{
+}
+
+disk::disk(std::shared_ptr<bus>& bus, std::unique_ptr<disk_image> image, bool async)
+: disk(bus, [&]()
+{
+    std::vector<std::unique_ptr<disk_image>> images;
+    images.push_back(std::move(image));
+    return images;
+}(), async)
+{
+}
+
+disk::disk(std::shared_ptr<bus>& bus, std::vector<std::unique_ptr<disk_image>> images, bool async)
 :
-m_file_size(),
 m_mode(DISK_MODES::READ),
 m_lba(0),
+m_lba_high(0),
 m_buf(),
 m_buf_index(0),
-m_file(),
-m_bus(bus)
+m_images(std::move(images)),
+m_drive(0),
+m_bus(bus),
+m_dma_addr(0),
+m_dma_count(0),
+m_dma_buf(),
+m_dma_commit(false),
+m_async(async),
+m_worker(),
+m_mutex(),
+m_request_cv(),
+m_done_cv(),
+m_request(),
+m_status(DISK_STATUS::READY),
+m_quit(false),
+m_readahead(),
+m_readahead_drive(0),
+m_readahead_next(0),
+m_readahead_end(0),
+m_last_read_lba(0xFFFFFFFF)
 {
-    m_file.open(disk_path, std::ios::in | std::ios::out | std::ios::binary);
-    if (!m_file.is_open())
-        throw std::invalid_argument(std::format("[DISK] Couldn't access {}", disk_path));
-
-    m_file.seekg(0, std::ios::end);
-    m_file_size = m_file.tellg();
-    m_file.seekg(0, std::ios::beg);
-
-    if (m_file_size % SECTOR_SIZE)
-        throw std::invalid_argument("[DISK] Incomplete sectors");
+    if (m_images.empty() || m_images.size() > 0xFFFF)
+        throw std::invalid_argument(std::format("[DISK] Invalid drive count {}", m_images.size()));
 
-    m_bus->bind_port(0x61, std::bind(&disk::set_mode, this, std::placeholders::_1));
-    m_bus->bind_port(0x62, std::bind(&disk::set_lba, this, std::placeholders::_1));
-    m_bus->bind_port(0x63, std::bind(&disk::do_it, this, std::placeholders::_1));
-    m_bus->bind_port(0x64, std::bind(&disk::request_read_write, this, std::placeholders::_1));
-    m_bus->bind_port(0x65, std::bind(&disk::get_sectors_count, this, std::placeholders::_1));
-    m_bus->bind_port(0x66, std::bind(&disk::end, this, std::placeholders::_1));
+    m_bus->bind_device(this);
+    if (m_async)
+        m_worker = std::thread(&disk::worker_loop, this);
 }
 
 disk::~disk()
 {
-    m_file.close();
+    if (m_async) {
+        // Let a queued write land before stopping
+        wait_idle();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_request_cv.notify_one();
+        m_worker.join();
+    }
 }
 
-u16 disk::set_mode(u16 mode)
+void disk::set_mode(u16 mode)
 {
+    wait_idle();
     m_buf_index = 0;
     std::memset(m_buf.data(), 0, SECTOR_SIZE);
     if (mode == DISK_MODES::READ)
@@ -63,58 +95,284 @@ u16 disk::set_mode(u16 mode)
     else if (mode == DISK_MODES::WRITE)
         m_mode = static_cast<DISK_MODES>(mode);
     else throw std::invalid_argument(std::format("[DISK] Unknown mode {}", mode));
-
-    // Return dummy
-    return PORT_DUMMY_VALUE;
 }
 
-u16 disk::set_lba(u16 lba)
+void disk::set_lba(u16 lba)
 {
+    wait_idle();
     m_buf_index = 0;
     std::memset(m_buf.data(), 0, SECTOR_SIZE);
-    m_lba = lba;
-    if (m_mode == DISK_MODES::READ)
-        m_file.seekg(m_lba * SECTOR_SIZE);
-    else if (m_mode == DISK_MODES::WRITE)
-        m_file.seekp(m_lba * SECTOR_SIZE);
-    // Return dummy
-    return PORT_DUMMY_VALUE;
+    m_lba = (static_cast<u32>(m_lba_high) << 16) | lba;
+    m_lba_high = 0;
 }
 
-u16 disk::do_it(u16)
+void disk::do_it(u16)
 {
-    if (m_mode == DISK_MODES::READ)
-        m_file.read(reinterpret_cast<char*>(m_buf.data()), SECTOR_SIZE);
-    else if (m_mode == DISK_MODES::WRITE)
-        m_file.write(reinterpret_cast<const char*>(m_buf.data()), SECTOR_SIZE);
-    // Return dummy
-    return PORT_DUMMY_VALUE;
+    if (!m_async) {
+        bool done = try_transfer({m_drive, m_mode, m_lba, 1, false, false});
+        m_status = done ? DISK_STATUS::READY : DISK_STATUS::FAILED;
+    } else {
+        wait_idle();
+        submit({m_drive, m_mode, m_lba, 1, false, false});
+    }
+    // Consecutive requests walk the disk like the old stream position did
+    m_lba++;
 }
 
-u16 disk::request_read_write(u16 data_in)
+u16 disk::get_byte()
 {
+    wait_idle();
     u16 data = 0;
-    if (m_buf_index != SECTOR_SIZE)
+    if (m_buf_index != SECTOR_SIZE && m_mode == DISK_MODES::READ)
+        data = m_buf.at(m_buf_index++);
+    return data;
+}
+
+void disk::put_byte(u16 data)
+{
+    wait_idle();
+    if (m_buf_index != SECTOR_SIZE && m_mode == DISK_MODES::WRITE)
+        m_buf[m_buf_index++] = data;
+}
+
+u16 disk::get_sectors_count()
+{
+    wait_idle();
+    return m_images[m_drive]->get_sectors_count() & 0xFFFF;
+}
+
+u16 disk::end()
+{
+    wait_idle();
+    return m_buf_index == SECTOR_SIZE;
+}
+
+u16 disk::get_status()
+{
+    if (!m_async)
+        return m_status;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_request.has_value())
+        return m_status;
+    lock.unlock();
+    commit_dma();
+    return m_status;
+}
+
+void disk::set_dma_addr(u16 addr)
+{
+    wait_idle();
+    m_dma_addr = addr;
+}
+
+void disk::set_dma_count(u16 count)
+{
+    wait_idle();
+    m_dma_count = count;
+}
+
+void disk::dma_start(u16)
+{
+    wait_idle();
+    u32 size = static_cast<u32>(m_dma_count) * SECTOR_SIZE;
+    if (m_dma_addr + size > MEM_SIZE) {
+        m_status = DISK_STATUS::FAILED;
+        return;
+    }
+
+    m_dma_buf.resize(size);
+    if (m_mode == DISK_MODES::WRITE)
+        m_bus->get_memory()->read_block(m_dma_addr, m_dma_buf.data(), size);
+
+    disk_request request{m_drive, m_mode, m_lba, m_dma_count, true, false};
+    if (!m_async) {
+        bool done = try_transfer(request);
+        m_dma_commit = done && (m_mode == DISK_MODES::READ);
+        commit_dma();
+        m_status = done ? DISK_STATUS::READY : DISK_STATUS::FAILED;
+    } else {
+        submit(request);
+    }
+    m_lba += m_dma_count;
+}
+
+void disk::flush(u16)
+{
+    if (!m_async) {
+        bool done = try_transfer({m_drive, m_mode, m_lba, 0, false, true});
+        m_status = done ? DISK_STATUS::READY : DISK_STATUS::FAILED;
+    } else {
+        wait_idle();
+        submit({m_drive, m_mode, m_lba, 0, false, true});
+    }
+}
+
+void disk::select_drive(u16 drive)
+{
+    wait_idle();
+    if (drive >= m_images.size()) {
+        m_status = DISK_STATUS::FAILED;
+        return;
+    }
+    m_drive = drive;
+    m_status = DISK_STATUS::READY;
+}
+
+void disk::set_lba_high(u16 lba_high)
+{
+    wait_idle();
+    m_lba_high = lba_high;
+}
+
+u16 disk::get_sectors_count_high()
+{
+    wait_idle();
+    return m_images[m_drive]->get_sectors_count() >> 16;
+}
+
+u16 disk::get_drive_count()
+{
+    return m_images.size();
+}
+
+// Guests that don't poll the status port still see synchronous behaviour
+void disk::wait_idle()
+{
+    if (!m_async)
+        return;
     {
-        if (m_mode == DISK_MODES::READ)
-        {
-            data = m_buf.at(m_buf_index++);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this]() { return !m_request.has_value(); });
+    }
+    commit_dma();
+}
+
+void disk::submit(disk_request request)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (request.mode == DISK_MODES::READ && !request.flush) {
+        // Read-ahead follows a single drive
+        if (request.drive != m_readahead_drive) {
+            m_readahead.clear();
+            m_readahead_drive = request.drive;
+            m_readahead_next = m_readahead_end = 0;
+            m_last_read_lba = 0xFFFFFFFF;
         }
-        else if (m_mode == DISK_MODES::WRITE)
-        {
-            m_buf[m_buf_index++] = data_in;
-            data = PORT_DUMMY_VALUE;
+        u32 request_end = request.lba + request.count;
+        // Sequential reads keep a window of sectors ahead of the guest
+        if (request.lba == m_last_read_lba + 1) {
+            m_readahead_next = std::max(m_readahead_next, request_end);
+            m_readahead_end = request_end + READAHEAD_SECTORS;
+        }
+        m_last_read_lba = request_end - 1;
+        std::erase_if(m_readahead, [&](const auto& sector) { return sector.first < request.lba; });
+
+        // Served from the window when it already holds every sector, DMA included
+        bool cached = true;
+        for (u32 lba = request.lba; lba < request_end && cached; lba++)
+            cached = m_readahead.contains(lba);
+        if (cached) {
+            u8* buf = request.dma ? m_dma_buf.data() : m_buf.data();
+            for (u32 i = 0; i < request.count; i++)
+                std::copy_n(m_readahead[request.lba + i].begin(), SECTOR_SIZE, buf + i * SECTOR_SIZE);
+            m_dma_commit = request.dma;
+            m_status = DISK_STATUS::READY;
+            lock.unlock();
+            m_request_cv.notify_one();
+            return;
         }
     }
-    return data;
+    m_request = request;
+    m_status = DISK_STATUS::BUSY;
+    lock.unlock();
+    m_request_cv.notify_one();
 }
 
-u16 disk::get_sectors_count(u16)
+// Runs on the emulation thread, or on the worker while the request is queued
+void disk::transfer(const disk_request& request)
 {
-    return m_file_size / SECTOR_SIZE;
+    disk_image& image = *m_images[request.drive];
+    if (request.flush) {
+        image.flush();
+        return;
+    }
+    u8* buf = request.dma ? m_dma_buf.data() : m_buf.data();
+    for (u32 i = 0; i < request.count; i++)
+    {
+        if (request.mode == DISK_MODES::READ)
+            image.read(request.lba + i, buf + i * SECTOR_SIZE);
+        else if (request.mode == DISK_MODES::WRITE)
+            image.write(request.lba + i, buf + i * SECTOR_SIZE);
+    }
 }
 
-u16 disk::end(u16)
+bool disk::try_transfer(const disk_request& request)
 {
-    return m_buf_index == SECTOR_SIZE;
+    try {
+        transfer(request);
+    } catch (const std::exception& err) {
+        std::clog << err.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Memory belongs to the emulation thread, finished DMA reads land here
+void disk::commit_dma()
+{
+    if (!m_dma_commit)
+        return;
+    m_dma_commit = false;
+    m_bus->get_memory()->write_block(m_dma_addr, m_dma_buf.data(), m_dma_buf.size());
+}
+
+void disk::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_request_cv.wait(lock, [this]()
+        {
+            return m_quit || m_request.has_value() || m_readahead_next < m_readahead_end;
+        });
+        if (m_quit)
+            break;
+
+        if (m_request.has_value()) {
+            disk_request request = m_request.value();
+            lock.unlock();
+            bool failed = !try_transfer(request);
+            lock.lock();
+            if (request.mode == DISK_MODES::WRITE && request.drive == m_readahead_drive)
+                std::erase_if(m_readahead, [&](const auto& sector)
+                {
+                    return sector.first >= request.lba && sector.first < request.lba + request.count;
+                });
+            m_dma_commit = request.dma && request.mode == DISK_MODES::READ && !failed;
+            m_request.reset();
+            m_status = failed ? DISK_STATUS::FAILED : DISK_STATUS::READY;
+            m_done_cv.notify_all();
+            continue;
+        }
+
+        // One sector at a time so a guest request never waits for the whole window
+        u32 lba = m_readahead_next++;
+        u16 drive = m_readahead_drive;
+        disk_image& image = *m_images[drive];
+        if (m_readahead.contains(lba) || lba >= image.get_sectors_count())
+            continue;
+        std::array<u8, SECTOR_SIZE> sector;
+        lock.unlock();
+        // A sector that can't be read is left out, the guest request reports it
+        bool done = true;
+        try {
+            image.read(lba, sector.data());
+        } catch (const std::exception&) {
+            done = false;
+        }
+        lock.lock();
+        // The guest may have moved to another drive meanwhile
+        if (done && drive == m_readahead_drive)
+            m_readahead.emplace(lba, sector);
+    }
 }
\ No newline at end of file
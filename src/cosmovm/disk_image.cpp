@@ -0,0 +1,115 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cosmovm/disk_image.hpp>
+#include <cosmovm/mmap_image.hpp>
+#include <cosmovm/overlay_image.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace cosmovm;
+
+stream_image::stream_image(const std::string& disk_path, SYNC_POLICY sync, bool read_only)
+:
+m_file(),
+m_fd(-1),
+m_sectors_count(0),
+m_sync(sync),
+m_read_only(read_only)
+{
+    if (m_read_only)
+        m_file.open(disk_path, std::ios::in | std::ios::binary);
+    else
+        m_file.open(disk_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+        throw std::invalid_argument(std::format("[DISK] Couldn't access {}", disk_path));
+
+    m_file.seekg(0, std::ios::end);
+    usz file_size = m_file.tellg();
+    m_file.seekg(0, std::ios::beg);
+
+    if (file_size % SECTOR_SIZE)
+        throw std::invalid_argument("[DISK] Incomplete sectors");
+    m_sectors_count = file_size / SECTOR_SIZE;
+#ifndef _WIN32
+    if (!m_read_only)
+        m_fd = ::open(disk_path.c_str(), O_RDWR);
+#endif
+}
+
+stream_image::~stream_image()
+{
+    if (m_sync != SYNC_POLICY::SYNC_NONE)
+        flush();
+    m_file.close();
+#ifndef _WIN32
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+void stream_image::read(u32 lba, u8* buf)
+{
+    // Unwritten sectors past the end read as zeroes
+    if (lba >= m_sectors_count) {
+        std::memset(buf, 0, SECTOR_SIZE);
+        return;
+    }
+    m_file.seekg(static_cast<std::streamoff>(lba) * SECTOR_SIZE);
+    m_file.read(reinterpret_cast<char*>(buf), SECTOR_SIZE);
+}
+
+void stream_image::write(u32 lba, const u8* buf)
+{
+    if (m_read_only)
+        throw std::invalid_argument(std::format("[DISK] Write to LBA {} of a read-only image", lba));
+    m_file.seekp(static_cast<std::streamoff>(lba) * SECTOR_SIZE);
+    m_file.write(reinterpret_cast<const char*>(buf), SECTOR_SIZE);
+    if (lba >= m_sectors_count)
+        m_sectors_count = lba + 1;
+    if (m_sync == SYNC_POLICY::SYNC_ON_WRITE)
+        flush();
+}
+
+u32 stream_image::get_sectors_count()
+{
+    return m_sectors_count;
+}
+
+void stream_image::flush()
+{
+    m_file.flush();
+#ifndef _WIN32
+    if (m_fd >= 0)
+        ::fsync(m_fd);
+#endif
+}
+
+std::unique_ptr<disk_image> cosmovm::open_disk_image(const std::string& disk_path, DISK_BACKENDS backend, SYNC_POLICY sync, bool read_only)
+{
+    if (overlay_image::is_overlay(disk_path))
+        return std::make_unique<overlay_image>(disk_path, backend, sync);
+#ifndef _WIN32
+    if (backend == DISK_BACKENDS::MMAP)
+        return std::make_unique<mmap_image>(disk_path, sync, read_only);
+#endif
+    return std::make_unique<stream_image>(disk_path, sync, read_only);
+}
\ No newline at end of file
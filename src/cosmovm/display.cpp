@@ -16,54 +16,135 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <cstring>
+#include <algorithm>
+#include <iostream>
 
 #include <cosmovm/display.hpp>
+#ifdef COSMOVM_SDL
+#include <cosmovm/sdl_backend.hpp>
+#endif
 
 using namespace cosmovm;
 
+constexpr u8 FRAME_INDEX = 0b0011;
+constexpr u8 FRAME_FRESH = 0b0100;
+constexpr u8 FRAME_STOP  = 0b1000;
+
+#ifdef COSMOVM_SDL
 display::display(std::shared_ptr<bus>& bus, const std::string& window_title)
 :
-m_bus(bus),
-m_video_mem_buf(m_bus->get_memory()->get_buf().begin() + VIDEO_START_ADDR),
-m_mode(VIDEO_MODES::TEXT)
+display(bus, [window_title]() { return std::make_unique<sdl_backend>(window_title); })
 {
-    SDL_CreateWindowAndRenderer(
-        WINDOW_W,
-        WINDOW_H,
-        0,
-        &m_window,
-        &m_renderer);
-    SDL_SetWindowTitle(m_window, window_title.c_str());
-    m_color = {0xDF, 0xDF, 0xDF, 0};
+}
+#endif
 
-    if((m_font = TTF_OpenFont(FONT_PATH.c_str(), 8)) == NULL)
-        throw std::invalid_argument(std::format("[DISPLAY] Couldn't find {}", FONT_PATH));
+display::display(std::shared_ptr<bus>& bus, const backend_factory& factory, bool render_thread)
+:
+m_backend(),
+m_text_screen(),
+m_tile_pixels(),
+m_shown_tiles(),
+m_drawn_mode(VIDEO_MODES::TEXT),
+m_vram_tracker(bus->get_memory()->add_dirty_tracker()),
+m_dirty_pages(),
+m_threaded(render_thread),
+m_frames(),
+m_middle(1),
+m_back(0),
+m_front(2),
+m_render_thread(),
+m_last_mode(VIDEO_MODES::TEXT),
+m_last_text(),
+m_last_page(0),
+m_frame_counter(0),
+m_vsync_wait(false),
+m_presented(0),
+m_skipped(0),
+m_dropped(0),
+m_capture(),
+m_shm(),
+m_bus(bus),
+m_page(0),
+m_next_page(0),
+m_video_mem_buf(m_bus->get_memory()->get_buf().data() + video_page_addr(m_page)),
+m_quit(false),
+m_mode(VIDEO_MODES::TEXT),
+m_text()
+{
+    if (m_threaded) {
+        // Backend errors (ex: missing font) are thrown here, not on the thread
+        // The thread owns the promise, it may still be in set_value once get returns
+        std::promise<void> ready;
+        std::future<void> started = ready.get_future();
+        m_render_thread = std::thread(&display::render_loop, this, std::cref(factory), std::move(ready));
+        try {
+            started.get();
+        } catch (...) {
+            m_render_thread.join();
+            throw;
+        }
+    } else {
+        m_backend = factory();
+    }
 
-    // Arbitrary port
-    m_bus->bind_port(0x44, std::bind(&display::change_mode, this, std::placeholders::_1));
+    m_bus->bind_device(this);
 }
 
 display::~display()
 {
-    TTF_CloseFont(m_font);
-    SDL_DestroyRenderer(m_renderer);
-    SDL_DestroyWindow(m_window);
+    finish();
+    std::cout << std::format("[DISPLAY] {} frames presented, {} skipped, {} dropped",
+        m_presented, m_skipped, m_dropped) << std::endl;
 }
 
 void display::run()
 {
-    switch (m_mode)
-    {
-        case VIDEO_MODES::TEXT:
-            render_text_mode();
-            break;
-        case VIDEO_MODES::GRAPHIC:
-            render_graphic_mode();
-            break;
-        default:
-            break;
+    m_frame_counter++;
+    m_vsync_wait = false;
+    if (m_next_page != m_page) {
+        m_page = m_next_page;
+        m_video_mem_buf = m_bus->get_memory()->get_buf().data() + video_page_addr(m_page);
     }
+
+    if (!m_threaded) {
+        if (!m_backend->poll_events())
+            m_quit = true;
+        gfx_rows dirty_rows{};
+        bool changed = collect_dirty_rows(dirty_rows);
+        if (changed && m_capture != nullptr)
+            m_capture->push(m_mode, m_text, m_video_mem_buf);
+        present(m_mode, m_text, m_video_mem_buf, dirty_rows, changed);
+        return;
+    }
+
+    // Unchanged frames are still handed over, the render thread polls events
+    // with them and may have to present again
+    frame_snapshot& frame = m_frames[m_back];
+    frame.mode = m_mode;
+    frame.text = m_text;
+    std::copy_n(m_video_mem_buf, VIDEO_MEM_SIZE, frame.vram.begin());
+    frame.dirty_rows.fill(false);
+    bool changed = collect_dirty_rows(frame.dirty_rows);
+    if (changed && m_capture != nullptr)
+        m_capture->push(m_mode, m_text, m_video_mem_buf);
+    frame.changed = changed;
+
+    // A frame not picked up yet may be replaced by this one, its rows are
+    // merged first. If the render thread takes it meanwhile the rows are
+    // only drawn twice, the render thread never writes a frame
+    u8 middle = m_middle.load(std::memory_order_acquire);
+    if (middle & FRAME_FRESH) {
+        const frame_snapshot& pending = m_frames[middle & FRAME_INDEX];
+        frame.changed = frame.changed || pending.changed;
+        for (u16 row = 0; row < GFX_MODE_H; row++)
+            frame.dirty_rows[row] = frame.dirty_rows[row] || pending.dirty_rows[row];
+    }
+
+    u8 previous = m_middle.exchange(m_back | FRAME_FRESH, std::memory_order_acq_rel);
+    m_middle.notify_one();
+    m_back = previous & FRAME_INDEX;
+    if (previous & FRAME_FRESH)
+        m_dropped++;
 }
 
 bool display::window_is_open()
@@ -71,91 +152,216 @@ bool display::window_is_open()
     return !m_quit;
 }
 
-u16 display::change_mode(u16 mode)
+void display::change_mode(u16 mode)
 {
-    switch (m_mode)
+    switch (mode)
     {
         case VIDEO_MODES::TEXT:
-            m_mode = static_cast<VIDEO_MODES>(mode);
-            break;
         case VIDEO_MODES::GRAPHIC:
+        case VIDEO_MODES::TILE:
             m_mode = static_cast<VIDEO_MODES>(mode);
             break;
         default:
-            throw std::invalid_argument(std::format("[DISPLAY] Unknown mode {}", mode));
+            m_bus->fault(0x44);
             break;
     }
-    // Return dummy
-    return PORT_DUMMY_VALUE;
 }
 
-void display::render_text_mode()
+u16 display::get_frame_counter()
 {
-    SDL_Surface* surface;
-    SDL_Texture* texture;
-    SDL_Rect rect;
-    SDL_Event event;
+    return m_frame_counter;
+}
 
-    if (*m_video_mem_buf != 0)
-    {
-        surface =
-            TTF_RenderUTF8_Solid_Wrapped(
-                m_font,
-                reinterpret_cast<const char*>(&(*m_video_mem_buf)),
-                m_color,
-                WINDOW_W);
-        texture = SDL_CreateTextureFromSurface(m_renderer, surface);
-        rect = {.x = 0, .y = 0, .w = surface->w, .h = static_cast<int>(surface->h * 2.125F)};
+void display::set_text_start(u16 start)
+{
+    m_text.start = start % TEXT_RING_CELLS;
+}
+
+u16 display::get_text_start()
+{
+    return m_text.start;
+}
+
+void display::set_text_cursor(u16 cursor)
+{
+    m_text.cursor = cursor;
+}
+
+u16 display::get_text_cursor()
+{
+    return m_text.cursor;
+}
+
+void display::set_text_attributes(u16 enabled)
+{
+    m_text.attributes = enabled != 0;
+}
+
+u16 display::get_text_attributes()
+{
+    return m_text.attributes;
+}
+
+void display::set_page(u16 page)
+{
+    if (page >= VIDEO_PAGES) {
+        m_bus->fault(0x49);
+        return;
     }
+    m_next_page = page;
+}
 
-    while (SDL_PollEvent(&event))
+u16 display::get_page()
+{
+    return m_page;
+}
+
+void display::wait_vsync(u16)
+{
+    m_vsync_wait = true;
+}
+
+bool display::waiting_vsync()
+{
+    return m_vsync_wait;
+}
+
+void display::finish()
+{
+    if (!m_render_thread.joinable())
+        return;
+    m_middle.fetch_or(FRAME_STOP, std::memory_order_acq_rel);
+    m_middle.notify_one();
+    m_render_thread.join();
+}
+
+void display::attach_capture(std::unique_ptr<frame_capture> capture)
+{
+    m_capture = std::move(capture);
+}
+
+void display::attach_shm(std::unique_ptr<shm_framebuffer> shm)
+{
+    m_shm = std::move(shm);
+}
+
+display_backend& display::get_backend()
+{
+    return *m_backend;
+}
+
+bool display::collect_dirty_rows(gfx_rows& dirty_rows)
+{
+    // Everything is drawn again after a mode change or a page flip
+    if (m_mode != m_last_mode || m_page != m_last_page) {
+        m_last_mode = m_mode;
+        m_last_page = m_page;
+        m_last_text = m_text;
+        m_bus->get_memory()->clear_dirty(m_vram_tracker);
+        dirty_rows.fill(true);
+        return true;
+    }
+
+    // Rows touched by dirty pages since the last frame
+    const std::shared_ptr<memory>& mem = m_bus->get_memory();
+    mem->get_dirty_pages(m_vram_tracker, m_dirty_pages);
+    for (u32 page : m_dirty_pages)
     {
-        if (event.type == SDL_QUIT)
-            m_quit = 1;
+        int start = static_cast<int>(page << PAGE_SHIFT) - video_page_addr(m_page);
+        int end = start + PAGE_SIZE;
+        if (end <= 0 || start >= GFX_MODE_W * GFX_MODE_H)
+            continue;
+        int first_row = std::max(start, 0) / GFX_MODE_W;
+        int last_row = std::min(end - 1, GFX_MODE_W * GFX_MODE_H - 1) / GFX_MODE_W;
+        std::fill(dirty_rows.begin() + first_row, dirty_rows.begin() + last_row + 1, true);
+    }
+    mem->clear_dirty(m_vram_tracker);
+
+    // The text ring and its attributes span all of VRAM, scrolling or moving
+    // the cursor changes the screen without a write
+    bool changed = std::any_of(dirty_rows.begin(), dirty_rows.end(), [](bool dirty) { return dirty; });
+    if (m_mode == VIDEO_MODES::TEXT && m_text != m_last_text) {
+        m_last_text = m_text;
+        changed = true;
     }
-    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
-    SDL_RenderClear(m_renderer);
-    if (*m_video_mem_buf != 0)
-        SDL_RenderCopy(m_renderer, texture, NULL, &rect);
-    SDL_RenderPresent(m_renderer);
+    return changed;
+}
 
-    if (*m_video_mem_buf != 0)
+void display::render_loop(const backend_factory& factory, std::promise<void> ready)
+{
+    try {
+        m_backend = factory();
+    } catch (...) {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    for (;;)
     {
-        SDL_FreeSurface(surface);
-        SDL_DestroyTexture(texture);
+        u8 middle = m_middle.load(std::memory_order_acquire);
+        if (middle & FRAME_FRESH) {
+            if (!m_middle.compare_exchange_weak(middle, m_front | (middle & FRAME_STOP), std::memory_order_acq_rel))
+                continue;
+            m_front = middle & FRAME_INDEX;
+            if (!m_backend->poll_events())
+                m_quit = true;
+            const frame_snapshot& frame = m_frames[m_front];
+            present(frame.mode, frame.text, frame.vram.data(), frame.dirty_rows, frame.changed);
+        } else if (middle & FRAME_STOP) {
+            break;
+        } else {
+            m_middle.wait(middle, std::memory_order_acquire);
+        }
     }
+    m_backend.reset();
 }
 
-void display::render_graphic_mode()
-{
-    SDL_Surface* surface;
-    SDL_Texture* texture;
-    SDL_Rect rect;
-    SDL_Event event;
-    surface =
-        SDL_CreateRGBSurfaceFrom(
-            (void*)m_video_mem_buf,
-            GFX_MODE_W,
-            GFX_MODE_H,
-            GFX_BIT_DEPTH,
-            GFX_MODE_W,
-            0b11100000,
-            0b00011100,
-            0b00000011,
-            0b0);
-    texture = SDL_CreateTextureFromSurface(m_renderer, surface);
-    rect = {.x = 0, .y = 0, .w = surface->w * (WINDOW_W / GFX_MODE_W), .h = surface->h * (WINDOW_H / GFX_MODE_H)};
-
-    while (SDL_PollEvent(&event))
+void display::draw_frame(display_backend& target, VIDEO_MODES mode, const u8* pixels, const gfx_rows& rows)
+{
+    if (mode == VIDEO_MODES::TEXT)
+        target.render_text(m_text_screen);
+    else
+        target.render_graphic(pixels, rows);
+}
+
+void display::present(VIDEO_MODES mode, const text_registers& text, const u8* vram, const gfx_rows& dirty_rows, bool changed)
+{
+    if (!changed && !m_backend->damaged()) {
+        m_skipped++;
+        return;
+    }
+    m_presented++;
+    // Graphic and tile modes share the backend picture
+    bool redraw = (mode != m_drawn_mode);
+    m_drawn_mode = mode;
+
+    const u8* pixels = vram;
+    gfx_rows tile_rows;
+    const gfx_rows* rows = &dirty_rows;
+    switch (mode)
     {
-        if (event.type == SDL_QUIT)
-            m_quit = 1;
+        case VIDEO_MODES::TEXT:
+            resolve_text_screen(vram, text, m_text_screen);
+            break;
+        case VIDEO_MODES::TILE:
+            compose_tiles(vram, m_tile_pixels.data());
+            for (u16 row = 0; row < GFX_MODE_H; row++)
+            {
+                auto line = m_tile_pixels.begin() + row * GFX_MODE_W;
+                tile_rows[row] = redraw || !std::equal(line, line + GFX_MODE_W, m_shown_tiles.begin() + row * GFX_MODE_W);
+            }
+            m_shown_tiles = m_tile_pixels;
+            pixels = m_tile_pixels.data();
+            rows = &tile_rows;
+            break;
+        default:
+            break;
     }
-    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
-    SDL_RenderClear(m_renderer);
-    SDL_RenderCopy(m_renderer, texture, NULL, &rect);
-    SDL_RenderPresent(m_renderer);
 
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
+    draw_frame(*m_backend, mode, pixels, *rows);
+    if (m_shm != nullptr) {
+        draw_frame(m_shm->get_screen(), mode, pixels, *rows);
+        m_shm->publish();
+    }
 }
\ No newline at end of file
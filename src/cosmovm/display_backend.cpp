@@ -0,0 +1,82 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <cosmovm/display_backend.hpp>
+#include <cosmovm/vga_font.hpp>
+
+using namespace cosmovm;
+
+void cosmovm::resolve_text_screen(const u8* vram, const text_registers& registers, text_screen& screen)
+{
+    // At most two pieces, the screen may wrap around the end of the ring
+    u16 start = registers.start % TEXT_RING_CELLS;
+    u16 first = std::min<u16>(screen.glyphs.size(), TEXT_RING_CELLS - start);
+    std::copy_n(vram + start, first, screen.glyphs.begin());
+    std::copy_n(vram, screen.glyphs.size() - first, screen.glyphs.begin() + first);
+
+    screen.attributes = registers.attributes;
+    if (registers.attributes) {
+        std::copy_n(vram + TEXT_ATTR_OFFSET + start, first, screen.attrs.begin());
+        std::copy_n(vram + TEXT_ATTR_OFFSET, screen.attrs.size() - first, screen.attrs.begin() + first);
+    } else {
+        auto end = std::find(screen.glyphs.begin(), screen.glyphs.end(), 0);
+        std::fill(end, screen.glyphs.end(), 0);
+        screen.attrs.fill(0);
+    }
+    screen.cursor = (registers.cursor < screen.glyphs.size()) ? registers.cursor : TEXT_CURSOR_HIDDEN;
+}
+
+void cosmovm::compose_tiles(const u8* vram, u8* pixels)
+{
+    for (u16 map_y = 0; map_y < TILE_MAP_H; map_y++)
+    {
+        for (u16 map_x = 0; map_x < TILE_MAP_W; map_x++)
+        {
+            const u8* entry = vram + TILE_MAP_OFFSET + (map_y * TILE_MAP_W + map_x) * 2;
+            const u8* tile = vram + TILESET_OFFSET + entry[0] * TILE_BYTES;
+            const u8* palette = vram + TILE_PALETTE_OFFSET + (entry[1] % TILE_PALETTES) * TILE_PALETTE_COLORS;
+            u8* dst = pixels + map_y * TILE_SIZE * GFX_MODE_W + map_x * TILE_SIZE;
+            for (u16 y = 0; y < TILE_SIZE; y++, dst += GFX_MODE_W)
+            {
+                // Leftmost pixel in the high bits
+                u16 row = (tile[y * 2] << 8) | tile[y * 2 + 1];
+                for (u16 x = 0; x < TILE_SIZE; x++)
+                    dst[x] = palette[(row >> (14 - x * 2)) & 0x3];
+            }
+        }
+    }
+}
+
+std::vector<u8> cosmovm::render_glyph_mask()
+{
+    // 8x8 glyphs stretched to the cell, like a TTF is
+    std::vector<u8> glyphs(GLYPH_COUNT * TEXT_CELL_W * TEXT_CELL_H, 0);
+    for (u16 glyph = 1; glyph < GLYPH_COUNT; glyph++)
+    {
+        for (u16 y = 0; y < TEXT_CELL_H; y++)
+        {
+            u8 row = VGA_FONT[glyph][y * VGA_FONT_H / TEXT_CELL_H];
+            u8* dst = glyphs.data() + (glyph * TEXT_CELL_H + y) * TEXT_CELL_W;
+            for (u16 x = 0; x < TEXT_CELL_W; x++)
+                dst[x] = (row & (0x80 >> (x * VGA_FONT_W / TEXT_CELL_W))) != 0;
+        }
+    }
+    return glyphs;
+}
\ No newline at end of file
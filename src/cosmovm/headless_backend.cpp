@@ -0,0 +1,141 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <cosmovm/headless_backend.hpp>
+#include <cosmovm/pixel.hpp>
+
+using namespace cosmovm;
+
+headless_backend::headless_backend(const std::string& dump_path)
+:
+m_framebuffer(WINDOW_W * WINDOW_H, TEXT_BACKGROUND),
+m_glyphs(render_glyph_mask()),
+m_text_shadow(),
+m_drawn_mode(VIDEO_MODES::TEXT),
+m_redraw(true),
+m_frames(0),
+m_dump_path(dump_path)
+{
+}
+
+headless_backend::~headless_backend()
+{
+    if (m_dump_path.empty())
+        return;
+    try {
+        std::cout << std::format("[DISPLAY] Dumping the last frame into {}...", m_dump_path) << std::endl;
+        dump_ppm(m_dump_path);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+    }
+}
+
+bool headless_backend::poll_events()
+{
+    return true;
+}
+
+void headless_backend::render_text(const text_screen& screen)
+{
+    // The framebuffer is shared by both modes
+    if (m_drawn_mode != VIDEO_MODES::TEXT) {
+        std::fill(m_framebuffer.begin(), m_framebuffer.end(), TEXT_BACKGROUND);
+        m_drawn_mode = VIDEO_MODES::TEXT;
+        m_redraw = true;
+    }
+
+    for (u16 cell = 0; cell < TEXT_MODE_W * TEXT_MODE_H; cell++)
+    {
+        if (!m_redraw && screen.same_cell(m_text_shadow, cell))
+            continue;
+
+        u32 foreground = screen.foreground(cell);
+        u32 background = screen.background(cell);
+        const u8* lit = m_glyphs.data() + screen.glyphs[cell] * TEXT_CELL_H * TEXT_CELL_W;
+        u32* dst = m_framebuffer.data()
+            + (cell / TEXT_MODE_W) * TEXT_CELL_H * WINDOW_W + (cell % TEXT_MODE_W) * TEXT_CELL_W;
+        for (u16 y = 0; y < TEXT_CELL_H; y++, dst += WINDOW_W, lit += TEXT_CELL_W)
+        {
+            bool cursor = (cell == screen.cursor && y >= TEXT_CELL_H - TEXT_CURSOR_LINES);
+            for (u16 x = 0; x < TEXT_CELL_W; x++)
+                dst[x] = (lit[x] || cursor) ? foreground : background;
+        }
+    }
+    m_text_shadow = screen;
+    m_redraw = false;
+    m_frames++;
+}
+
+void headless_backend::render_graphic(const u8* pixels, const gfx_rows& dirty_rows)
+{
+    if (m_drawn_mode != VIDEO_MODES::GRAPHIC) {
+        m_drawn_mode = VIDEO_MODES::GRAPHIC;
+        m_redraw = true;
+    }
+
+    // Converted and scaled one run of consecutive dirty rows at a time
+    for (u16 row = 0; row < GFX_MODE_H;)
+    {
+        if (!m_redraw && !dirty_rows[row]) {
+            row++;
+            continue;
+        }
+        u16 run_end = row;
+        while (run_end < GFX_MODE_H && (m_redraw || dirty_rows[run_end]))
+            run_end++;
+        rgb332_to_rgba(
+            pixels + row * GFX_MODE_W, GFX_MODE_W,
+            m_framebuffer.data() + row * GFX_SCALE * WINDOW_W, WINDOW_W,
+            GFX_MODE_W, run_end - row, GFX_SCALE);
+        row = run_end;
+    }
+    m_redraw = false;
+    m_frames++;
+}
+
+const std::vector<u32>& headless_backend::get_framebuffer() const
+{
+    return m_framebuffer;
+}
+
+usz headless_backend::get_frames_count() const
+{
+    return m_frames;
+}
+
+void headless_backend::dump_ppm(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::out);
+    if (!file.is_open())
+        throw std::invalid_argument(std::format("[DISPLAY] Couldn't open {}", path));
+
+    file << std::format("P6\n{} {}\n255\n", WINDOW_W, WINDOW_H);
+    std::vector<char> rgb(m_framebuffer.size() * 3);
+    for (usz i = 0; i < m_framebuffer.size(); i++)
+    {
+        rgb[i * 3] = m_framebuffer[i] >> 24;
+        rgb[i * 3 + 1] = m_framebuffer[i] >> 16;
+        rgb[i * 3 + 2] = m_framebuffer[i] >> 8;
+    }
+    file.write(rgb.data(), rgb.size());
+}
\ No newline at end of file
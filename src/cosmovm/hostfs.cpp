@@ -0,0 +1,255 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <cosmovm/hostfs.hpp>
+
+using namespace cosmovm;
+
+hostfs::hostfs(std::shared_ptr<bus>& bus, const std::string& root)
+:
+m_bus(bus),
+m_root(),
+m_files(),
+m_read_only(),
+m_handle(0),
+m_addr(0),
+m_length(0),
+m_offset(0),
+m_status(HOSTFS_STATUS::HOSTFS_OK),
+m_transferred(0),
+m_buf()
+{
+    std::error_code error;
+    m_root = std::filesystem::canonical(root, error);
+    if (error || !std::filesystem::is_directory(m_root))
+        throw std::invalid_argument(std::format("[HOSTFS] {} isn't a directory", root));
+
+    m_bus->bind_device(this);
+}
+
+hostfs::~hostfs()
+{
+}
+
+void hostfs::run_command(u16 command)
+{
+    switch (command)
+    {
+        case HOSTFS_COMMANDS::HOSTFS_OPEN: m_status = open(false); break;
+        case HOSTFS_COMMANDS::HOSTFS_CREATE: m_status = open(true); break;
+        case HOSTFS_COMMANDS::HOSTFS_READ: m_status = read(); break;
+        case HOSTFS_COMMANDS::HOSTFS_WRITE: m_status = write(); break;
+        case HOSTFS_COMMANDS::HOSTFS_SEEK: m_status = seek(); break;
+        case HOSTFS_COMMANDS::HOSTFS_CLOSE: m_status = close(); break;
+        default: m_status = HOSTFS_STATUS::HOSTFS_BAD_COMMAND; break;
+    }
+}
+
+void hostfs::set_handle(u16 handle)
+{
+    m_handle = handle;
+}
+
+u16 hostfs::get_handle()
+{
+    return m_handle;
+}
+
+void hostfs::set_addr(u16 addr)
+{
+    m_addr = addr;
+}
+
+void hostfs::set_length(u16 length)
+{
+    m_length = length;
+}
+
+u16 hostfs::get_transferred()
+{
+    return m_transferred;
+}
+
+void hostfs::set_offset_low(u16 offset)
+{
+    m_offset = (m_offset & 0xFFFF0000) | offset;
+}
+
+void hostfs::set_offset_high(u16 offset)
+{
+    m_offset = (m_offset & 0x0000FFFF) | (static_cast<u32>(offset) << 16);
+}
+
+u16 hostfs::get_offset_low()
+{
+    return m_offset & 0xFFFF;
+}
+
+u16 hostfs::get_offset_high()
+{
+    return m_offset >> 16;
+}
+
+u16 hostfs::get_status()
+{
+    return m_status;
+}
+
+HOSTFS_STATUS hostfs::open(bool create)
+{
+    // Path is a NUL terminated string in guest memory, a longer one isn't cut
+    std::string name;
+    bool terminated = false;
+    for (u16 i = 0; i < HOSTFS_MAX_PATH && !terminated; i++)
+    {
+        if (m_addr + i >= MEM_SIZE)
+            return HOSTFS_STATUS::HOSTFS_BAD_ADDRESS;
+        u8 c = m_bus->mem_read8(m_addr + i);
+        if (c == '\0')
+            terminated = true;
+        else
+            name.push_back(c);
+    }
+    if (!terminated)
+        return HOSTFS_STATUS::HOSTFS_BAD_PATH;
+
+    std::filesystem::path path = name;
+    if (!resolve(path))
+        return HOSTFS_STATUS::HOSTFS_DENIED;
+    if (!create && !std::filesystem::is_regular_file(path))
+        return HOSTFS_STATUS::HOSTFS_NOT_FOUND;
+
+    auto free_file = std::find_if(m_files.begin(), m_files.end(),
+        [](const std::fstream& file) { return !file.is_open(); });
+    if (free_file == m_files.end())
+        return HOSTFS_STATUS::HOSTFS_BAD_HANDLE;
+
+    std::ios::openmode mode = std::ios::in | std::ios::out | std::ios::binary;
+    if (create)
+        mode |= std::ios::trunc;
+    free_file->open(path, mode);
+    bool read_only = false;
+    if (!free_file->is_open() && !create) {
+        free_file->clear();
+        free_file->open(path, std::ios::in | std::ios::binary);
+        read_only = true;
+    }
+    if (!free_file->is_open())
+        return HOSTFS_STATUS::HOSTFS_IO_ERROR;
+
+    m_handle = free_file - m_files.begin();
+    m_read_only[m_handle] = read_only;
+    m_offset = 0;
+    return HOSTFS_STATUS::HOSTFS_OK;
+}
+
+HOSTFS_STATUS hostfs::read()
+{
+    m_transferred = 0;
+    std::fstream* file = current_file();
+    if (file == nullptr)
+        return HOSTFS_STATUS::HOSTFS_BAD_HANDLE;
+    if (m_addr + m_length > MEM_SIZE)
+        return HOSTFS_STATUS::HOSTFS_BAD_ADDRESS;
+
+    // Bulk copy into guest memory, a short count means end of file
+    m_buf.resize(m_length);
+    file->clear();
+    file->seekg(m_offset);
+    file->read(reinterpret_cast<char*>(m_buf.data()), m_length);
+    m_transferred = file->gcount();
+    if (file->bad())
+        return HOSTFS_STATUS::HOSTFS_IO_ERROR;
+
+    m_bus->get_memory()->write_block(m_addr, m_buf.data(), m_transferred);
+    m_offset += m_transferred;
+    return HOSTFS_STATUS::HOSTFS_OK;
+}
+
+HOSTFS_STATUS hostfs::write()
+{
+    m_transferred = 0;
+    std::fstream* file = current_file();
+    if (file == nullptr)
+        return HOSTFS_STATUS::HOSTFS_BAD_HANDLE;
+    if (m_read_only[m_handle])
+        return HOSTFS_STATUS::HOSTFS_DENIED;
+    if (m_addr + m_length > MEM_SIZE)
+        return HOSTFS_STATUS::HOSTFS_BAD_ADDRESS;
+
+    m_buf.resize(m_length);
+    m_bus->get_memory()->read_block(m_addr, m_buf.data(), m_length);
+    file->clear();
+    file->seekp(m_offset);
+    file->write(reinterpret_cast<const char*>(m_buf.data()), m_length);
+    if (!file->good())
+        return HOSTFS_STATUS::HOSTFS_IO_ERROR;
+
+    m_transferred = m_length;
+    m_offset += m_transferred;
+    return HOSTFS_STATUS::HOSTFS_OK;
+}
+
+// Positions live in the offset ports, reads and writes advance them
+HOSTFS_STATUS hostfs::seek()
+{
+    if (current_file() == nullptr)
+        return HOSTFS_STATUS::HOSTFS_BAD_HANDLE;
+    return HOSTFS_STATUS::HOSTFS_OK;
+}
+
+HOSTFS_STATUS hostfs::close()
+{
+    std::fstream* file = current_file();
+    if (file == nullptr)
+        return HOSTFS_STATUS::HOSTFS_BAD_HANDLE;
+    file->close();
+    return HOSTFS_STATUS::HOSTFS_OK;
+}
+
+// Relative paths only, under the root and without symlinks
+bool hostfs::resolve(std::filesystem::path& path)
+{
+    if (path.empty() || path.has_root_name() || path.has_root_directory())
+        return false;
+
+    // Each component is looked at without following it, a symlink (even
+    // dangling, create would make its target) could lead out of the root
+    std::filesystem::path resolved = m_root;
+    for (const auto& part : path)
+    {
+        if (part == "..")
+            return false;
+        resolved /= part;
+        std::error_code error;
+        if (std::filesystem::is_symlink(std::filesystem::symlink_status(resolved, error)))
+            return false;
+    }
+
+    path = resolved;
+    return true;
+}
+
+std::fstream* hostfs::current_file()
+{
+    if (m_handle >= HOSTFS_MAX_HANDLES || !m_files[m_handle].is_open())
+        return nullptr;
+    return &m_files[m_handle];
+}
\ No newline at end of file
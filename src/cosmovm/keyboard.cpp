@@ -28,33 +28,29 @@ m_key_selector(0),
 m_sdl_kb_state(SDL_GetKeyboardState(NULL)),
 m_bus(bus)
 {
-    m_bus->bind_port(0x51, std::bind(&keyboard::set_key_selector, this, std::placeholders::_1));
-    m_bus->bind_port(0x52, std::bind(&keyboard::get_requested_key, this, std::placeholders::_1));
-    m_bus->bind_port(0x53, std::bind(&keyboard::get_pressed_key, this, std::placeholders::_1));
+    m_bus->bind_device(this);
 }
 
 keyboard::~keyboard()
 {
 }
 
-u16 keyboard::set_key_selector(u16 key_selector)
+void keyboard::set_key_selector(u16 key_selector)
 {
     m_key_selector = key_selector;
-    return PORT_DUMMY_VALUE;
 }
 
-u16 keyboard::get_requested_key(u16)
+u16 keyboard::get_requested_key()
 {
     return m_sdl_kb_state[m_key_selector];
 }
 
-u16 keyboard::get_pressed_key(u16)
+u16 keyboard::get_pressed_key()
 {
+    // The display pumps events every frame and leaves the key presses queued
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        if (event.type == SDL_KEYDOWN) {
-            return event.key.keysym.scancode;
-        }
+    if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_KEYDOWN, SDL_KEYDOWN) == 1) {
+        return event.key.keysym.scancode;
     }
     return SDL_SCANCODE_UNKNOWN;
 }
\ No newline at end of file
@@ -16,7 +16,10 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <bit>
 #include <fstream>
+#include <stdexcept>
 
 #include <cosmovm/memory.hpp>
 
@@ -24,14 +27,30 @@ using namespace cosmovm;
 
 memory::memory()
 :
-m_mem_buf()
+m_mem_buf(MEM_SIZE),
+m_windows({0x0000, 0x4000, 0x8000, 0xC000}),
+m_dirty(MEM_SIZE / PAGE_SIZE / 64),
+m_trackers()
 {
 }
 
 memory::memory(u16 addr, const std::vector<u8>& buf, u16 sz)
 :
-m_mem_buf()
+memory(MEM_SIZE, addr, buf, sz)
 {
+}
+
+memory::memory(u32 phys_size, u16 addr, const std::vector<u8>& buf, u16 sz)
+:
+m_mem_buf(),
+m_windows({0x0000, 0x4000, 0x8000, 0xC000}),
+m_dirty(),
+m_trackers()
+{
+    if (phys_size < MEM_SIZE || phys_size > MAX_PHYS_MEM_SIZE || phys_size % BANK_SIZE)
+        throw std::invalid_argument(std::format("[MEMORY] Invalid physical memory size 0x{:X}", phys_size));
+    m_mem_buf.resize(phys_size);
+    m_dirty.resize(phys_size / PAGE_SIZE / 64);
     load(addr, buf, sz);
 }
 
@@ -39,36 +58,152 @@ memory::~memory() {}
 
 u8 memory::read8(u16 addr)
 {
-    return m_mem_buf.at(addr);
+    return m_mem_buf[translate(addr)];
 }
 
 u16 memory::read16(u16 addr)
 {
-    return static_cast<u16>(m_mem_buf.at(addr + 1)) << 8 | m_mem_buf.at(addr);
+    return static_cast<u16>(m_mem_buf[translate(addr + 1)]) << 8 | m_mem_buf[translate(addr)];
 }
 
 void memory::write8(u16 addr, u8 data)
 {
-    m_mem_buf.at(addr) = data;
+    u32 phys_addr = translate(addr);
+    m_mem_buf[phys_addr] = data;
+    mark_dirty(phys_addr);
 }
 void memory::write16(u16 addr, u16 data)
 {
-    m_mem_buf.at(addr) = data & 0xFF;
-    m_mem_buf.at(addr + 1) = data >> 8;
+    u32 phys_addr_low = translate(addr);
+    u32 phys_addr_high = translate(addr + 1);
+    m_mem_buf[phys_addr_low] = data & 0xFF;
+    m_mem_buf[phys_addr_high] = data >> 8;
+    mark_dirty(phys_addr_low);
+    mark_dirty(phys_addr_high);
 }
 
 void memory::load(u16 offset, const std::vector<u8>& buf, u16 sz)
 {
     std::copy(buf.begin(), buf.begin() + sz, m_mem_buf.begin() + offset);
+    mark_dirty(offset, sz);
 }
 
-const std::array<u8, MEM_SIZE>& memory::get_buf() const
+void memory::read_block(u16 addr, u8* buf, u32 size)
+{
+    u32 virt_addr = addr;
+    while (size > 0)
+    {
+        // Copy up to the end of the current window
+        u32 chunk = std::min(size, BANK_SIZE - (virt_addr & BANK_MASK));
+        u32 phys_addr = translate(virt_addr);
+        std::copy_n(m_mem_buf.begin() + phys_addr, chunk, buf);
+        virt_addr += chunk;
+        buf += chunk;
+        size -= chunk;
+    }
+}
+
+void memory::write_block(u16 addr, const u8* buf, u32 size)
+{
+    u32 virt_addr = addr;
+    while (size > 0)
+    {
+        u32 chunk = std::min(size, BANK_SIZE - (virt_addr & BANK_MASK));
+        u32 phys_addr = translate(virt_addr);
+        std::copy_n(buf, chunk, m_mem_buf.begin() + phys_addr);
+        mark_dirty(phys_addr, chunk);
+        virt_addr += chunk;
+        buf += chunk;
+        size -= chunk;
+    }
+}
+
+const std::vector<u8>& memory::get_buf() const
 {
     return m_mem_buf;
 }
 
+void memory::map_window(u16 window, u16 bank)
+{
+    if (bank >= get_bank_count())
+        throw std::invalid_argument(std::format("[MEMORY] Invalid bank {}", bank));
+    m_windows.at(window) = static_cast<u32>(bank) << BANK_SHIFT;
+}
+
+u16 memory::get_window_bank(u16 window) const
+{
+    return m_windows.at(window) >> BANK_SHIFT;
+}
+
+u16 memory::get_bank_count() const
+{
+    return m_mem_buf.size() >> BANK_SHIFT;
+}
+
+usz memory::add_dirty_tracker()
+{
+    // A new consumer hasn't seen anything yet
+    m_trackers.push_back({std::vector<u64>(m_dirty.size(), ~u64{0}), 0});
+    return m_trackers.size() - 1;
+}
+
+void memory::get_dirty_pages(usz tracker, std::vector<u32>& pages)
+{
+    collect_dirty();
+    const std::vector<u64>& bitmap = m_trackers.at(tracker).pages;
+    pages.clear();
+    for (usz word = 0; word < bitmap.size(); word++)
+    {
+        for (u64 bits = bitmap[word]; bits != 0; bits &= bits - 1)
+            pages.push_back(word * 64 + std::countr_zero(bits));
+    }
+}
+
+void memory::clear_dirty(usz tracker)
+{
+    // Hand pending writes to the other consumers before forgetting them
+    collect_dirty();
+    dirty_tracker& consumer = m_trackers.at(tracker);
+    std::fill(consumer.pages.begin(), consumer.pages.end(), 0);
+    consumer.epoch++;
+}
+
+u64 memory::get_dirty_epoch(usz tracker) const
+{
+    return m_trackers.at(tracker).epoch;
+}
+
 void memory::dump()
 {
     std::ofstream dump_file{DUMP_PATH, std::ios::binary | std::ios::out};
-    dump_file.write(reinterpret_cast<const char*>(m_mem_buf.data()), MEM_SIZE);
+    dump_file.write(reinterpret_cast<const char*>(m_mem_buf.data()), m_mem_buf.size());
+}
+
+u32 memory::translate(u32 addr) const
+{
+    // Past the end of the address space throws like the flat buffer did
+    return m_windows.at(addr >> BANK_SHIFT) | (addr & BANK_MASK);
+}
+
+void memory::mark_dirty(u32 phys_addr)
+{
+    m_dirty[phys_addr >> (PAGE_SHIFT + 6)] |= u64{1} << ((phys_addr >> PAGE_SHIFT) & 63);
+}
+
+void memory::mark_dirty(u32 phys_addr, u32 size)
+{
+    for (u32 page_addr = phys_addr & ~(PAGE_SIZE - 1); page_addr < phys_addr + size; page_addr += PAGE_SIZE)
+        mark_dirty(page_addr);
+}
+
+void memory::collect_dirty()
+{
+    for (usz word = 0; word < m_dirty.size(); word++)
+    {
+        if (m_dirty[word] == 0)
+            continue;
+        for (dirty_tracker& consumer : m_trackers)
+            consumer.pages[word] |= m_dirty[word];
+        m_dirty[word] = 0;
+    }
 }
\ No newline at end of file
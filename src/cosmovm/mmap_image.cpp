@@ -0,0 +1,141 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cosmovm/mmap_image.hpp>
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cosmovm;
+
+mmap_image::mmap_image(const std::string& disk_path, SYNC_POLICY sync, bool read_only, u64 max_size)
+:
+m_fd(-1),
+m_map(nullptr),
+m_map_size(0),
+m_size(0),
+m_max_size(max_size),
+m_sync(sync),
+m_read_only(read_only)
+{
+    m_fd = ::open(disk_path.c_str(), m_read_only ? O_RDONLY : O_RDWR);
+    if (m_fd < 0)
+        throw std::invalid_argument(std::format("[DISK] Couldn't access {}", disk_path));
+
+    struct stat file_stat;
+    if (::fstat(m_fd, &file_stat) < 0) {
+        ::close(m_fd);
+        throw std::invalid_argument(std::format("[DISK] Couldn't stat {}", disk_path));
+    }
+    if (file_stat.st_size % SECTOR_SIZE) {
+        ::close(m_fd);
+        throw std::invalid_argument("[DISK] Incomplete sectors");
+    }
+    try {
+        remap(file_stat.st_size);
+    } catch (...) {
+        ::close(m_fd);
+        throw;
+    }
+    m_size = file_stat.st_size;
+    // Images already past the limit keep their size, but don't grow
+    m_max_size = std::max<u64>(m_max_size, m_size);
+}
+
+mmap_image::~mmap_image()
+{
+    if (m_sync != SYNC_POLICY::SYNC_NONE && !m_read_only)
+        flush();
+    if (m_map != nullptr)
+        ::munmap(m_map, m_map_size);
+    // Drops the padding of the last growth chunk
+    if (m_map_size > m_size && ::ftruncate(m_fd, m_size) < 0)
+        std::clog << "[DISK] Couldn't trim the image padding" << std::endl;
+    ::close(m_fd);
+}
+
+void mmap_image::read(u32 lba, u8* buf)
+{
+    usz offset = static_cast<usz>(lba) * SECTOR_SIZE;
+    if (offset >= m_size) {
+        std::memset(buf, 0, SECTOR_SIZE);
+        return;
+    }
+    std::memcpy(buf, m_map + offset, SECTOR_SIZE);
+}
+
+void mmap_image::write(u32 lba, const u8* buf)
+{
+    if (m_read_only)
+        throw std::invalid_argument(std::format("[DISK] Write to LBA {} of a read-only image", lba));
+    usz offset = static_cast<usz>(lba) * SECTOR_SIZE;
+    usz end = offset + SECTOR_SIZE;
+    if (end > m_max_size)
+        throw std::invalid_argument(std::format("[DISK] Write to LBA {} past the image size limit", lba));
+    if (end > m_map_size) {
+        usz grown = std::min<u64>((end + MMAP_GROWTH_CHUNK - 1) / MMAP_GROWTH_CHUNK * MMAP_GROWTH_CHUNK, m_max_size);
+        if (::ftruncate(m_fd, grown) < 0)
+            throw std::invalid_argument(std::format("[DISK] Couldn't grow image to LBA {}", lba));
+        remap(grown);
+    }
+    m_size = std::max(m_size, end);
+    std::memcpy(m_map + offset, buf, SECTOR_SIZE);
+    if (m_sync == SYNC_POLICY::SYNC_ON_WRITE) {
+        // msync wants a page aligned start
+        usz page_start = offset - (offset % ::sysconf(_SC_PAGESIZE));
+        ::msync(m_map + page_start, offset + SECTOR_SIZE - page_start, MS_SYNC);
+    }
+}
+
+u32 mmap_image::get_sectors_count()
+{
+    return m_size / SECTOR_SIZE;
+}
+
+void mmap_image::flush()
+{
+    if (m_map != nullptr)
+        ::msync(m_map, m_map_size, MS_SYNC);
+}
+
+void mmap_image::remap(usz size)
+{
+    // The old mapping stays valid if the new one fails
+    void* map = nullptr;
+    // mmap refuses empty mappings
+    if (size != 0) {
+        int protection = m_read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+        map = ::mmap(nullptr, size, protection, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED)
+            throw std::invalid_argument("[DISK] Couldn't map image");
+    }
+    if (m_map != nullptr)
+        ::munmap(m_map, m_map_size);
+    m_map = static_cast<u8*>(map);
+    m_map_size = size;
+}
+
+#endif
\ No newline at end of file
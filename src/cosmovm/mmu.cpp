@@ -0,0 +1,52 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cosmovm/mmu.hpp>
+
+using namespace cosmovm;
+
+mmu::mmu(std::shared_ptr<bus>& bus)
+:
+m_bus(bus)
+{
+    m_bus->bind_device(this);
+}
+
+mmu::~mmu()
+{
+}
+
+template<u16 WINDOW>
+void mmu::select_bank(u16 bank)
+{
+    if (bank >= get_bank_count()) {
+        m_bus->fault(PORTS[WINDOW].port);
+        return;
+    }
+    m_bus->get_memory()->map_window(WINDOW, bank);
+}
+
+template void mmu::select_bank<0>(u16 bank);
+template void mmu::select_bank<1>(u16 bank);
+template void mmu::select_bank<2>(u16 bank);
+template void mmu::select_bank<3>(u16 bank);
+
+u16 mmu::get_bank_count()
+{
+    return m_bus->get_memory()->get_bank_count();
+}
\ No newline at end of file
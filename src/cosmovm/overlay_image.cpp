@@ -0,0 +1,216 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <filesystem>
+
+#include <cosmovm/overlay_image.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace cosmovm;
+
+overlay_image::overlay_image(const std::string& overlay_path, DISK_BACKENDS base_backend, SYNC_POLICY sync)
+:
+m_file(),
+m_fd(-1),
+m_base(),
+m_table(),
+m_data_offset(0),
+m_clusters_count(0),
+m_sync(sync)
+{
+    m_file.open(overlay_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+        throw std::invalid_argument(std::format("[DISK] Couldn't access {}", overlay_path));
+
+    std::unique_ptr<overlay_header> header = std::make_unique<overlay_header>();
+    m_file.read(reinterpret_cast<char*>(header.get()), sizeof(overlay_header));
+    if (!m_file || OVERLAY_MAGIC.compare(0, OVERLAY_MAGIC.size(), header->magic, sizeof(header->magic)) != 0)
+        throw std::invalid_argument(std::format("[DISK] {} isn't an overlay", overlay_path));
+    if (header->version != OVERLAY_VERSION)
+        throw std::invalid_argument(std::format("[DISK] Unsupported overlay version {}", header->version));
+
+    m_file.seekg(0, std::ios::end);
+    u64 file_size = m_file.tellg();
+    m_data_offset = header->data_offset;
+    u64 table_end = OVERLAY_HEADER_SIZE + static_cast<u64>(header->sectors_count) * sizeof(u32);
+    if (header->sectors_count > OVERLAY_MAX_SECTORS || m_data_offset < table_end)
+        throw std::invalid_argument(std::format("[DISK] Invalid overlay table size in {}", overlay_path));
+    if (file_size < m_data_offset)
+        throw std::invalid_argument("[DISK] Incomplete overlay clusters");
+
+    m_table.resize(header->sectors_count);
+    m_file.seekg(OVERLAY_HEADER_SIZE);
+    m_file.read(reinterpret_cast<char*>(m_table.data()), m_table.size() * sizeof(u32));
+    if (!m_file)
+        throw std::invalid_argument(std::format("[DISK] Incomplete overlay table in {}", overlay_path));
+    // A cluster cut short by a crash has no entry yet, the next one allocated overwrites it
+    m_clusters_count = (file_size - m_data_offset) / SECTOR_SIZE;
+
+    // Entries are written after their cluster, one past the end was never
+    // completed and the sector keeps reading from the base. Without a sync
+    // policy the host may reorder the two writes, so this is best effort
+    for (u32 lba = 0; lba < m_table.size(); lba++)
+    {
+        if (m_table[lba] != OVERLAY_ZERO && m_table[lba] > m_clusters_count) {
+            m_table[lba] = OVERLAY_BASE;
+            write_entry(lba);
+        }
+    }
+
+    header->base_path[OVERLAY_PATH_SIZE - 1] = '\0';
+    m_base = open_disk_image(header->base_path, base_backend, SYNC_POLICY::SYNC_NONE, true);
+#ifndef _WIN32
+    m_fd = ::open(overlay_path.c_str(), O_RDWR);
+#endif
+}
+
+overlay_image::~overlay_image()
+{
+    if (m_sync != SYNC_POLICY::SYNC_NONE)
+        flush();
+    m_file.close();
+#ifndef _WIN32
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+void overlay_image::read(u32 lba, u8* buf)
+{
+    u32 entry = (lba < m_table.size()) ? m_table[lba] : OVERLAY_ZERO;
+    if (entry == OVERLAY_BASE) {
+        m_base->read(lba, buf);
+    } else if (entry == OVERLAY_ZERO) {
+        std::memset(buf, 0, SECTOR_SIZE);
+    } else {
+        m_file.seekg(cluster_offset(entry));
+        m_file.read(reinterpret_cast<char*>(buf), SECTOR_SIZE);
+        if (!m_file) {
+            // Later requests must not inherit the failure
+            m_file.clear();
+            throw std::invalid_argument(std::format("[DISK] Couldn't read cluster {} of LBA {}", entry, lba));
+        }
+    }
+}
+
+void overlay_image::write(u32 lba, const u8* buf)
+{
+    if (lba >= m_table.size())
+        throw std::invalid_argument(std::format("[DISK] Write to LBA {} past the end of the overlay", lba));
+
+    u32& entry = m_table[lba];
+    bool zero = std::all_of(buf, buf + SECTOR_SIZE, [](u8 byte) { return byte == 0; });
+    if (zero && entry == OVERLAY_ZERO)
+        return;
+
+    // Zero sectors only take a table entry, unless they already own a cluster
+    if (zero && entry == OVERLAY_BASE) {
+        entry = OVERLAY_ZERO;
+        write_entry(lba);
+    } else {
+        // The data goes before the entry, with a barrier in between when syncing so a
+        // crash can't leave an entry pointing at a cluster that never reached the disk
+        bool allocate = (entry == OVERLAY_BASE || entry == OVERLAY_ZERO);
+        u32 cluster = allocate ? m_clusters_count + 1 : entry;
+        m_file.seekp(cluster_offset(cluster));
+        m_file.write(reinterpret_cast<const char*>(buf), SECTOR_SIZE);
+        if (!m_file) {
+            m_file.clear();
+            throw std::invalid_argument(std::format("[DISK] Couldn't write cluster {} of LBA {}", cluster, lba));
+        }
+        if (allocate) {
+            if (m_sync != SYNC_POLICY::SYNC_NONE)
+                flush();
+            m_clusters_count = cluster;
+            entry = cluster;
+            write_entry(lba);
+        }
+    }
+    if (m_sync == SYNC_POLICY::SYNC_ON_WRITE)
+        flush();
+}
+
+u32 overlay_image::get_sectors_count()
+{
+    return m_table.size();
+}
+
+void overlay_image::flush()
+{
+    m_file.flush();
+#ifndef _WIN32
+    if (m_fd >= 0)
+        ::fsync(m_fd);
+#endif
+}
+
+bool overlay_image::is_overlay(const std::string& path)
+{
+    std::ifstream file{path, std::ios::in | std::ios::binary};
+    std::string magic(OVERLAY_MAGIC.size(), '\0');
+    file.read(magic.data(), magic.size());
+    return file && magic == OVERLAY_MAGIC;
+}
+
+void overlay_image::create(const std::string& overlay_path, const std::string& base_path, u32 sectors_count)
+{
+    std::string absolute_base = std::filesystem::absolute(base_path).string();
+    if (absolute_base.size() >= OVERLAY_PATH_SIZE)
+        throw std::invalid_argument(std::format("[DISK] Base path {} is too long", absolute_base));
+    if (sectors_count > OVERLAY_MAX_SECTORS)
+        throw std::invalid_argument(std::format("[DISK] Overlays are limited to {} sectors", OVERLAY_MAX_SECTORS));
+    if (overlay_image::is_overlay(base_path))
+        throw std::invalid_argument("[DISK] Overlays can't be stacked");
+
+    std::unique_ptr<overlay_header> header = std::make_unique<overlay_header>();
+    std::copy(OVERLAY_MAGIC.begin(), OVERLAY_MAGIC.end(), header->magic);
+    header->version = OVERLAY_VERSION;
+    header->sectors_count = sectors_count;
+    u64 table_end = OVERLAY_HEADER_SIZE + static_cast<u64>(sectors_count) * sizeof(u32);
+    header->data_offset = (table_end + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+    std::copy(absolute_base.begin(), absolute_base.end(), header->base_path);
+
+    {
+        std::ofstream file{overlay_path, std::ios::out | std::ios::binary | std::ios::trunc};
+        if (!file.is_open())
+            throw std::invalid_argument(std::format("[DISK] Couldn't create {}", overlay_path));
+        file.write(reinterpret_cast<const char*>(header.get()), sizeof(overlay_header));
+    }
+    // A zeroed table means every sector reads from the base, the filesystem keeps it sparse
+    std::filesystem::resize_file(overlay_path, header->data_offset);
+}
+
+void overlay_image::write_entry(u32 lba)
+{
+    m_file.seekp(OVERLAY_HEADER_SIZE + static_cast<u64>(lba) * sizeof(u32));
+    m_file.write(reinterpret_cast<const char*>(&m_table[lba]), sizeof(u32));
+    if (!m_file) {
+        m_file.clear();
+        throw std::invalid_argument(std::format("[DISK] Couldn't write the overlay entry of LBA {}", lba));
+    }
+}
+
+u64 overlay_image::cluster_offset(u32 cluster) const
+{
+    return m_data_offset + static_cast<u64>(cluster - 1) * SECTOR_SIZE;
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <cosmovm/pixel.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COSMOVM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace cosmovm;
+
+static void convert_row_scalar(const u8* src, u32* dst, u16 width, u16 scale)
+{
+    for (u16 x = 0; x < width; x++)
+        std::fill_n(dst + x * scale, scale, RGB332_PALETTE[src[x]]);
+}
+
+#ifdef COSMOVM_X86_KERNELS
+__attribute__((target("ssse3")))
+static void convert_row_ssse3(const u8* src, u32* dst, u16 width, u16 scale)
+{
+    // Channel levels indexed by the 3 or 2 bit field, pshufb picks from them
+    const __m128i levels3 = _mm_setr_epi8(0, 36, 72, 109, (char)145, (char)182, (char)218, (char)255, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i levels2 = _mm_setr_epi8(0, 85, (char)170, (char)255, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask3 = _mm_set1_epi8(0b111);
+    const __m128i mask2 = _mm_set1_epi8(0b11);
+    const __m128i alpha = _mm_set1_epi8((char)0xFF);
+
+    u16 x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        // No 8-bit shifts, shift 16-bit lanes and mask the bits that came across
+        __m128i r = _mm_shuffle_epi8(levels3, _mm_and_si128(_mm_srli_epi16(pixels, 5), mask3));
+        __m128i g = _mm_shuffle_epi8(levels3, _mm_and_si128(_mm_srli_epi16(pixels, 2), mask3));
+        __m128i b = _mm_shuffle_epi8(levels2, _mm_and_si128(pixels, mask2));
+
+        // Bytes A B G R in memory make 0xRRGGBBAA
+        __m128i ab_lo = _mm_unpacklo_epi8(alpha, b);
+        __m128i ab_hi = _mm_unpackhi_epi8(alpha, b);
+        __m128i gr_lo = _mm_unpacklo_epi8(g, r);
+        __m128i gr_hi = _mm_unpackhi_epi8(g, r);
+        __m128i rgba[4] = {
+            _mm_unpacklo_epi16(ab_lo, gr_lo),
+            _mm_unpackhi_epi16(ab_lo, gr_lo),
+            _mm_unpacklo_epi16(ab_hi, gr_hi),
+            _mm_unpackhi_epi16(ab_hi, gr_hi)};
+
+        __m128i* out = reinterpret_cast<__m128i*>(dst + x * scale);
+        for (int i = 0; i < 4; i++)
+        {
+            if (scale == 1) {
+                _mm_storeu_si128(out + i, rgba[i]);
+            } else {
+                _mm_storeu_si128(out + i * 4, _mm_shuffle_epi32(rgba[i], 0x00));
+                _mm_storeu_si128(out + i * 4 + 1, _mm_shuffle_epi32(rgba[i], 0x55));
+                _mm_storeu_si128(out + i * 4 + 2, _mm_shuffle_epi32(rgba[i], 0xAA));
+                _mm_storeu_si128(out + i * 4 + 3, _mm_shuffle_epi32(rgba[i], 0xFF));
+            }
+        }
+    }
+    convert_row_scalar(src + x, dst + x * scale, width - x, scale);
+}
+
+__attribute__((target("avx2")))
+static void convert_row_avx2(const u8* src, u32* dst, u16 width, u16 scale)
+{
+    // pshufb looks up within each 128-bit lane, both lanes get the levels
+    const __m256i levels3 = _mm256_setr_epi8(
+        0, 36, 72, 109, (char)145, (char)182, (char)218, (char)255, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 36, 72, 109, (char)145, (char)182, (char)218, (char)255, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i levels2 = _mm256_setr_epi8(
+        0, 85, (char)170, (char)255, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 85, (char)170, (char)255, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask3 = _mm256_set1_epi8(0b111);
+    const __m256i mask2 = _mm256_set1_epi8(0b11);
+    const __m256i alpha = _mm256_set1_epi8((char)0xFF);
+    const __m256i repeat[4] = {
+        _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1),
+        _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3),
+        _mm256_setr_epi32(4, 4, 4, 4, 5, 5, 5, 5),
+        _mm256_setr_epi32(6, 6, 6, 6, 7, 7, 7, 7)};
+
+    u16 x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+        __m256i r = _mm256_shuffle_epi8(levels3, _mm256_and_si256(_mm256_srli_epi16(pixels, 5), mask3));
+        __m256i g = _mm256_shuffle_epi8(levels3, _mm256_and_si256(_mm256_srli_epi16(pixels, 2), mask3));
+        __m256i b = _mm256_shuffle_epi8(levels2, _mm256_and_si256(pixels, mask2));
+
+        __m256i ab_lo = _mm256_unpacklo_epi8(alpha, b);
+        __m256i ab_hi = _mm256_unpackhi_epi8(alpha, b);
+        __m256i gr_lo = _mm256_unpacklo_epi8(g, r);
+        __m256i gr_hi = _mm256_unpackhi_epi8(g, r);
+        // Unpacks stay within lanes: rgba[i] holds pixels 4i..4i+3 in its
+        // low lane and 16+4i..16+4i+3 in its high lane
+        __m256i rgba[4] = {
+            _mm256_unpacklo_epi16(ab_lo, gr_lo),
+            _mm256_unpackhi_epi16(ab_lo, gr_lo),
+            _mm256_unpacklo_epi16(ab_hi, gr_hi),
+            _mm256_unpackhi_epi16(ab_hi, gr_hi)};
+
+        u32* out = dst + x * scale;
+        for (int i = 0; i < 4; i++)
+        {
+            if (scale == 1) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm256_castsi256_si128(rgba[i]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 + i * 4), _mm256_extracti128_si256(rgba[i], 1));
+            } else {
+                u32* low = out + i * 16;
+                u32* high = out + 64 + i * 16;
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(low), _mm256_permutevar8x32_epi32(rgba[i], repeat[0]));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(low + 8), _mm256_permutevar8x32_epi32(rgba[i], repeat[1]));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(high), _mm256_permutevar8x32_epi32(rgba[i], repeat[2]));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(high + 8), _mm256_permutevar8x32_epi32(rgba[i], repeat[3]));
+            }
+        }
+    }
+    convert_row_ssse3(src + x, dst + x * scale, width - x, scale);
+}
+#endif
+
+PIXEL_KERNELS cosmovm::best_pixel_kernel()
+{
+#ifdef COSMOVM_X86_KERNELS
+    static const PIXEL_KERNELS best = []()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return PIXEL_KERNELS::KERNEL_AVX2;
+        if (__builtin_cpu_supports("ssse3"))
+            return PIXEL_KERNELS::KERNEL_SSSE3;
+        return PIXEL_KERNELS::KERNEL_SCALAR;
+    }();
+    return best;
+#else
+    return PIXEL_KERNELS::KERNEL_SCALAR;
+#endif
+}
+
+void cosmovm::rgb332_to_rgba(
+    const u8* src, usz src_pitch,
+    u32* dst, usz dst_pitch,
+    u16 width, u16 height, u16 scale,
+    PIXEL_KERNELS kernel)
+{
+    void (*convert_row)(const u8*, u32*, u16, u16) = convert_row_scalar;
+#ifdef COSMOVM_X86_KERNELS
+    if (scale == 1 || scale == 4) {
+        if (kernel == PIXEL_KERNELS::KERNEL_AVX2)
+            convert_row = convert_row_avx2;
+        else if (kernel == PIXEL_KERNELS::KERNEL_SSSE3)
+            convert_row = convert_row_ssse3;
+    }
+#else
+    (void)kernel;
+#endif
+
+    for (u16 y = 0; y < height; y++, src += src_pitch)
+    {
+        u32* row = dst + y * scale * dst_pitch;
+        convert_row(src, row, width, scale);
+        // The other lines of the scaled row are copies of the first
+        for (u16 line = 1; line < scale; line++)
+            std::copy_n(row, width * scale, row + line * dst_pitch);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+
+#include <SDL2/SDL_ttf.h>
+
+#include <cosmovm/pixel.hpp>
+#include <cosmovm/sdl_backend.hpp>
+
+using namespace cosmovm;
+
+constexpr int KEY_QUEUE_MAX = 64;
+
+// RGBA8888 surface of GLYPH_COUNT white glyphs on transparent, ATLAS_COLUMNS per row.
+// An empty path uses the built-in font, a TTF needs TTF_Init
+static SDL_Surface* render_glyph_atlas(const std::string& font_path)
+{
+    TTF_Font* font = NULL;
+    if (!font_path.empty()) {
+        font = TTF_OpenFont(font_path.c_str(), 8);
+        if (font == NULL)
+            throw std::invalid_argument(std::format("[DISPLAY] Couldn't find {}", font_path));
+    }
+
+    SDL_Surface* atlas =
+        SDL_CreateRGBSurfaceWithFormat(
+            0,
+            ATLAS_COLUMNS * TEXT_CELL_W,
+            (GLYPH_COUNT / ATLAS_COLUMNS) * TEXT_CELL_H,
+            32,
+            SDL_PIXELFORMAT_RGBA8888);
+    SDL_FillRect(atlas, NULL, SDL_MapRGBA(atlas->format, 0, 0, 0, 0));
+
+    // White on transparent, the color of each cell is applied when drawing.
+    // Glyph 0 stays blank, it ends the text like the string renderer did
+    if (font == NULL) {
+        std::vector<u8> glyphs = render_glyph_mask();
+        u32 lit = SDL_MapRGBA(atlas->format, 0xFF, 0xFF, 0xFF, 0xFF);
+        SDL_LockSurface(atlas);
+        for (u16 glyph = 1; glyph < GLYPH_COUNT; glyph++)
+        {
+            u16 cell_x = (glyph % ATLAS_COLUMNS) * TEXT_CELL_W;
+            u16 cell_y = (glyph / ATLAS_COLUMNS) * TEXT_CELL_H;
+            for (u16 y = 0; y < TEXT_CELL_H; y++)
+            {
+                const u8* src = glyphs.data() + (glyph * TEXT_CELL_H + y) * TEXT_CELL_W;
+                u32* dst = reinterpret_cast<u32*>(static_cast<u8*>(atlas->pixels) + (cell_y + y) * atlas->pitch) + cell_x;
+                for (u16 x = 0; x < TEXT_CELL_W; x++)
+                    if (src[x])
+                        dst[x] = lit;
+            }
+        }
+        SDL_UnlockSurface(atlas);
+        return atlas;
+    }
+
+    SDL_Color color = {0xFF, 0xFF, 0xFF, 0xFF};
+    for (u16 glyph = 1; glyph < GLYPH_COUNT; glyph++)
+    {
+        SDL_Surface* surface = TTF_RenderGlyph_Solid(font, glyph, color);
+        if (surface == NULL)
+            continue;
+        SDL_Rect cell = {
+            .x = (glyph % ATLAS_COLUMNS) * TEXT_CELL_W,
+            .y = (glyph / ATLAS_COLUMNS) * TEXT_CELL_H,
+            .w = TEXT_CELL_W,
+            .h = TEXT_CELL_H};
+        SDL_BlitScaled(surface, NULL, atlas, &cell);
+        SDL_FreeSurface(surface);
+    }
+
+    TTF_CloseFont(font);
+    return atlas;
+}
+
+sdl_backend::sdl_backend(const std::string& window_title, const std::string& font_path)
+:
+m_glyph_atlas(nullptr),
+m_text_target(nullptr),
+m_text_shadow(),
+m_text_redraw(true),
+m_gfx_texture(nullptr),
+m_gfx_redraw(true),
+m_damaged(true)
+{
+    SDL_CreateWindowAndRenderer(
+        WINDOW_W,
+        WINDOW_H,
+        0,
+        &m_window,
+        &m_renderer);
+    SDL_SetWindowTitle(m_window, window_title.c_str());
+
+    SDL_Surface* atlas = render_glyph_atlas(font_path);
+    m_glyph_atlas = SDL_CreateTextureFromSurface(m_renderer, atlas);
+    SDL_SetTextureBlendMode(m_glyph_atlas, SDL_BLENDMODE_BLEND);
+    SDL_FreeSurface(atlas);
+    m_text_target = SDL_CreateTexture(
+        m_renderer,
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_TARGET,
+        TEXT_MODE_W * TEXT_CELL_W,
+        TEXT_MODE_H * TEXT_CELL_H);
+    m_gfx_texture = SDL_CreateTexture(
+        m_renderer,
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        GFX_MODE_W * GFX_SCALE,
+        GFX_MODE_H * GFX_SCALE);
+}
+
+sdl_backend::~sdl_backend()
+{
+    SDL_DestroyTexture(m_gfx_texture);
+    SDL_DestroyTexture(m_text_target);
+    SDL_DestroyTexture(m_glyph_atlas);
+    SDL_DestroyRenderer(m_renderer);
+    SDL_DestroyWindow(m_window);
+}
+
+bool sdl_backend::poll_events()
+{
+    // Key presses stay queued for the keyboard device, which may run on
+    // another thread, everything else is handled or dropped here
+    SDL_PumpEvents();
+    bool open = (SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_QUIT, SDL_QUIT) == 0);
+    // Textures lose their content with the device
+    if (SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_RENDER_TARGETS_RESET, SDL_RENDER_DEVICE_RESET) > 0)
+        m_text_redraw = m_gfx_redraw = m_damaged = true;
+    // The window content is gone, the last frame has to be presented again
+    SDL_Event event;
+    while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_WINDOWEVENT, SDL_WINDOWEVENT) == 1)
+        if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+            m_damaged = true;
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_KEYDOWN - 1);
+    SDL_FlushEvents(SDL_KEYDOWN + 1, SDL_LASTEVENT);
+    // Unless the guest never reads them
+    if (SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_KEYDOWN, SDL_KEYDOWN) > KEY_QUEUE_MAX)
+        SDL_FlushEvent(SDL_KEYDOWN);
+    return open;
+}
+
+bool sdl_backend::damaged()
+{
+    return m_damaged;
+}
+
+void sdl_backend::render_text(const text_screen& screen)
+{
+    // Only cells that changed since the last frame are drawn again
+    bool target_bound = false;
+    for (u16 cell = 0; cell < TEXT_MODE_W * TEXT_MODE_H; cell++)
+    {
+        if (!m_text_redraw && screen.same_cell(m_text_shadow, cell))
+            continue;
+
+        if (!target_bound) {
+            SDL_SetRenderTarget(m_renderer, m_text_target);
+            target_bound = true;
+        }
+        u8 glyph = screen.glyphs[cell];
+        u32 foreground = screen.foreground(cell);
+        u32 background = screen.background(cell);
+        SDL_Rect src = {
+            .x = (glyph % ATLAS_COLUMNS) * TEXT_CELL_W,
+            .y = (glyph / ATLAS_COLUMNS) * TEXT_CELL_H,
+            .w = TEXT_CELL_W,
+            .h = TEXT_CELL_H};
+        SDL_Rect dst = {
+            .x = (cell % TEXT_MODE_W) * TEXT_CELL_W,
+            .y = (cell / TEXT_MODE_W) * TEXT_CELL_H,
+            .w = TEXT_CELL_W,
+            .h = TEXT_CELL_H};
+        // Background first, then the glyph tinted with the foreground
+        SDL_SetRenderDrawColor(m_renderer, background >> 24, background >> 16, background >> 8, 0xFF);
+        SDL_RenderFillRect(m_renderer, &dst);
+        SDL_SetTextureColorMod(m_glyph_atlas, foreground >> 24, foreground >> 16, foreground >> 8);
+        SDL_RenderCopy(m_renderer, m_glyph_atlas, &src, &dst);
+        if (cell == screen.cursor) {
+            SDL_Rect underline = {.x = dst.x, .y = dst.y + TEXT_CELL_H - TEXT_CURSOR_LINES, .w = TEXT_CELL_W, .h = TEXT_CURSOR_LINES};
+            SDL_SetRenderDrawColor(m_renderer, foreground >> 24, foreground >> 16, foreground >> 8, 0xFF);
+            SDL_RenderFillRect(m_renderer, &underline);
+        }
+    }
+    m_text_shadow = screen;
+    m_text_redraw = false;
+    m_damaged = false;
+    if (target_bound)
+        SDL_SetRenderTarget(m_renderer, NULL);
+
+    SDL_Rect rect = {.x = 0, .y = 0, .w = TEXT_MODE_W * TEXT_CELL_W, .h = TEXT_MODE_H * TEXT_CELL_H};
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(m_renderer);
+    SDL_RenderCopy(m_renderer, m_text_target, NULL, &rect);
+    SDL_RenderPresent(m_renderer);
+}
+
+void sdl_backend::render_graphic(const u8* pixels, const gfx_rows& dirty_rows)
+{
+    // One upload per run of consecutive dirty rows
+    for (u16 row = 0; row < GFX_MODE_H;)
+    {
+        if (!m_gfx_redraw && !dirty_rows[row]) {
+            row++;
+            continue;
+        }
+        u16 run_end = row;
+        while (run_end < GFX_MODE_H && (m_gfx_redraw || dirty_rows[run_end]))
+            run_end++;
+        // Converted and scaled straight into the texture, the renderer copies it 1:1
+        SDL_Rect rows = {
+            .x = 0, .y = row * GFX_SCALE,
+            .w = GFX_MODE_W * GFX_SCALE, .h = (run_end - row) * GFX_SCALE};
+        void* texels;
+        int pitch;
+        if (SDL_LockTexture(m_gfx_texture, &rows, &texels, &pitch) == 0) {
+            rgb332_to_rgba(
+                pixels + row * GFX_MODE_W, GFX_MODE_W,
+                static_cast<u32*>(texels), pitch / sizeof(u32),
+                GFX_MODE_W, run_end - row, GFX_SCALE);
+            SDL_UnlockTexture(m_gfx_texture);
+        }
+        row = run_end;
+    }
+    m_gfx_redraw = false;
+    m_damaged = false;
+
+    SDL_Rect rect = {.x = 0, .y = 0, .w = GFX_MODE_W * GFX_SCALE, .h = GFX_MODE_H * GFX_SCALE};
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(m_renderer);
+    SDL_RenderCopy(m_renderer, m_gfx_texture, NULL, &rect);
+    SDL_RenderPresent(m_renderer);
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cosmovm/sector_cache.hpp>
+
+using namespace cosmovm;
+
+sector_cache::sector_cache(std::unique_ptr<disk_image> image, usz capacity, CACHE_POLICY policy)
+:
+m_image(std::move(image)),
+m_capacity(std::max<usz>(capacity, 1)),
+m_policy(policy),
+m_entries(),
+m_index(),
+m_sectors_count(m_image->get_sectors_count()),
+m_hits(0),
+m_misses(0),
+m_flushes(0)
+{
+}
+
+sector_cache::~sector_cache()
+{
+    // Errors can't leave a destructor, a sector that isn't written is reported
+    // and the others are still tried
+    for (cache_entry& entry : m_entries)
+    {
+        try {
+            write_back(entry);
+        } catch (const std::exception& err) {
+            std::clog << err.what() << std::endl;
+        }
+    }
+    try {
+        m_image->flush();
+    } catch (const std::exception& err) {
+        std::clog << err.what() << std::endl;
+    }
+    std::clog << std::format("[DISK] Cache: {} hits, {} misses, {} sectors flushed",
+        m_hits, m_misses, m_flushes) << std::endl;
+}
+
+void sector_cache::read(u32 lba, u8* buf)
+{
+    cache_entry& entry = lookup(lba, true);
+    std::memcpy(buf, entry.data.data(), SECTOR_SIZE);
+}
+
+void sector_cache::write(u32 lba, const u8* buf)
+{
+    // A full sector overwrite doesn't need the old contents
+    cache_entry& entry = lookup(lba, false);
+    std::memcpy(entry.data.data(), buf, SECTOR_SIZE);
+    entry.dirty = true;
+    m_sectors_count = std::max(m_sectors_count, lba + 1);
+    if (m_policy == CACHE_POLICY::WRITE_THROUGH)
+        write_back(entry);
+}
+
+u32 sector_cache::get_sectors_count()
+{
+    return m_sectors_count;
+}
+
+void sector_cache::flush()
+{
+    if (m_policy == CACHE_POLICY::FLUSH_ON_EXIT)
+        return;
+    write_back_all();
+    m_image->flush();
+}
+
+cache_entry& sector_cache::lookup(u32 lba, bool fill)
+{
+    auto cached = m_index.find(lba);
+    if (cached != m_index.end()) {
+        m_hits++;
+        m_entries.splice(m_entries.begin(), m_entries, cached->second);
+        return m_entries.front();
+    }
+
+    m_misses++;
+    // Read before the cache changes, a failed read leaves no entry behind
+    std::array<u8, SECTOR_SIZE> data{};
+    if (fill)
+        m_image->read(lba, data.data());
+    if (m_entries.size() >= m_capacity) {
+        write_back(m_entries.back());
+        m_index.erase(m_entries.back().lba);
+        m_entries.pop_back();
+    }
+    m_entries.push_front({lba, false, data});
+    m_index[lba] = m_entries.begin();
+    return m_entries.front();
+}
+
+void sector_cache::write_back(cache_entry& entry)
+{
+    if (!entry.dirty)
+        return;
+    m_image->write(entry.lba, entry.data.data());
+    entry.dirty = false;
+    m_flushes++;
+}
+
+void sector_cache::write_back_all()
+{
+    for (cache_entry& entry : m_entries)
+        write_back(entry);
+}
\ No newline at end of file
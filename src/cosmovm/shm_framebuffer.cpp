@@ -0,0 +1,110 @@
+/**
+ * CosmoVM an emulator and assembler for an imaginary cpu
+ * Copyright (C) 2022 JeSuis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <cosmovm/shm_framebuffer.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace cosmovm;
+
+shm_framebuffer::shm_framebuffer(const std::string& name)
+:
+m_name(name.starts_with('/') ? name : "/" + name),
+m_fd(-1),
+m_map(nullptr),
+m_map_size(SHM_HEADER_SIZE + WINDOW_W * WINDOW_H * sizeof(u32)),
+m_header(nullptr),
+m_screen()
+{
+#ifndef _WIN32
+    // Never taken over, it may belong to another emulator. Only a segment
+    // created here is unlinked
+    m_fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (m_fd < 0 && errno == EEXIST)
+        throw std::invalid_argument(std::format("[SHM] {} already exists, used by another emulator or left by a crash (/dev/shm{})", m_name, m_name));
+    if (m_fd < 0)
+        throw std::invalid_argument(std::format("[SHM] Couldn't create {}", m_name));
+    if (::ftruncate(m_fd, m_map_size) < 0) {
+        ::close(m_fd);
+        ::shm_unlink(m_name.c_str());
+        throw std::invalid_argument(std::format("[SHM] Couldn't size {}", m_name));
+    }
+    void* map = ::mmap(nullptr, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED) {
+        ::close(m_fd);
+        ::shm_unlink(m_name.c_str());
+        throw std::invalid_argument(std::format("[SHM] Couldn't map {}", m_name));
+    }
+    m_map = static_cast<u8*>(map);
+
+    // The sequence starts even
+    m_header = new (m_map) shm_header{
+        .magic = SHM_MAGIC,
+        .version = SHM_VERSION,
+        .header_size = SHM_HEADER_SIZE,
+        .width = WINDOW_W,
+        .height = WINDOW_H,
+        .pitch = WINDOW_W * sizeof(u32),
+        .sequence = 0,
+        .frames = 0};
+    publish();
+#else
+    throw std::invalid_argument("[SHM] Shared memory export needs POSIX shared memory");
+#endif
+}
+
+shm_framebuffer::~shm_framebuffer()
+{
+#ifndef _WIN32
+    // Viewers still attached keep their mapping
+    ::munmap(m_map, m_map_size);
+    ::close(m_fd);
+    ::shm_unlink(m_name.c_str());
+#endif
+}
+
+display_backend& shm_framebuffer::get_screen()
+{
+    return m_screen;
+}
+
+void shm_framebuffer::publish()
+{
+    // Seqlock, odd while the pixels are copied. Readers never block the display
+    u64 sequence = m_header->sequence.load(std::memory_order_relaxed);
+    m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const std::vector<u32>& pixels = m_screen.get_framebuffer();
+    std::memcpy(m_map + SHM_HEADER_SIZE, pixels.data(), pixels.size() * sizeof(u32));
+    m_header->frames++;
+    m_header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+const std::string& shm_framebuffer::get_name() const
+{
+    return m_name;
+}
\ No newline at end of file
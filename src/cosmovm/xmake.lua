@@ -3,15 +3,31 @@ target("cosmocore_static")
     set_kind("static")
     set_basename("cosmovm")
     add_files(
+        "ansi_backend.cpp",
+        "blitter.cpp",
         "bus.cpp",
+        "capture.cpp",
         "clock.cpp",
         "cpu.cpp",
         "disk.cpp",
+        "disk_image.cpp",
         "display.cpp",
-        "keyboard.cpp",
-        "memory.cpp")
+        "display_backend.cpp",
+        "headless_backend.cpp",
+        "hostfs.cpp",
+        "memory.cpp",
+        "mmap_image.cpp",
+        "mmu.cpp",
+        "overlay_image.cpp",
+        "pixel.cpp",
+        "sector_cache.cpp",
+        "shm_framebuffer.cpp")
     add_includedirs(ROOT_DIR .. "include")
-    add_links("SDL2", "SDL2_ttf")
+    add_options("sdl")
+    if has_config("sdl") then
+        add_files("keyboard.cpp", "sdl_backend.cpp")
+        add_links("SDL2", "SDL2_ttf")
+    end
     local local_ROOT_DIR = ROOT_DIR
     after_build(function (target)
         os.cp(target:targetfile(), local_ROOT_DIR .. "build")
@@ -25,15 +41,32 @@ target("cosmocore_shared")
     -- set_configdir(".")
     -- add_configfiles("cosmocore_config.hpp.in")
     add_files(
+        "ansi_backend.cpp",
+        "blitter.cpp",
         "bus.cpp",
+        "capture.cpp",
         "clock.cpp",
         "cpu.cpp",
         "disk.cpp",
+        "disk_image.cpp",
         "display.cpp",
-        "keyboard.cpp",
-        "memory.cpp")
+        "display_backend.cpp",
+        "headless_backend.cpp",
+        "hostfs.cpp",
+        "memory.cpp",
+        "mmap_image.cpp",
+        "mmu.cpp",
+        "overlay_image.cpp",
+        "pixel.cpp",
+        "sector_cache.cpp",
+        "shm_framebuffer.cpp")
     add_includedirs(ROOT_DIR .. "include")
-    add_links("SDL2", "SDL2_ttf", "gomp")
+    add_links("gomp")
+    add_options("sdl")
+    if has_config("sdl") then
+        add_files("keyboard.cpp", "sdl_backend.cpp")
+        add_links("SDL2", "SDL2_ttf")
+    end
     local local_ROOT_DIR = ROOT_DIR
     after_build(function (target)
         os.cp(target:targetfile(), local_ROOT_DIR .. "build")
@@ -4,7 +4,17 @@ set_project("CosmoVM")
 set_version("2.0.0")
 set_languages("cxxlatest")
 
-add_requires("sdl2", "sdl2_ttf", {configs = {binaryonly = true}})
+-- xmake f --sdl=n builds without the window backend, the keyboard and cosmobench
+option("sdl")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Build the SDL window backend")
+    add_defines("COSMOVM_SDL")
+option_end()
+
+if has_config("sdl") then
+    add_requires("sdl2", "sdl2_ttf", {configs = {binaryonly = true}})
+end
 
 set_warnings("everything")
 if is_mode("release") then
@@ -18,4 +28,7 @@ if is_plat("window") then
 else
     ROOT_DIR = path.absolute(".") .. "/"
 end
-includes("src/cosmoemu")
\ No newline at end of file
+includes("src/cosmoemu")
+if has_config("sdl") then
+    includes("src/cosmobench")
+end
\ No newline at end of file